@@ -0,0 +1,257 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#include "completion.h"
+#include "connectiontable.h"
+#include "sshdatabase.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <unordered_set>
+#include <fstream>
+#include <sstream>
+
+/** BEGIN completion scripts **/
+
+static const char *bashScript = R"SCRIPT(_scc()
+{
+    local cur="${COMP_WORDS[COMP_CWORD]}"
+    local IFS=$'\n'
+    if [ "$COMP_CWORD" -eq 1 ]; then
+        COMPREPLY=( $( compgen -W "$( printf '%s\n' connect --list --import --daemon --completion-script --help )" -- "$cur" ) )
+    elif [ "$COMP_CWORD" -eq 2 ]; then
+        case "${COMP_WORDS[1]}" in
+        connect) COMPREPLY=( $( scc --complete name "$cur" ) ) ;;
+        --list) [[ "$cur" == -* ]] && COMPREPLY=( $( compgen -W "$( printf '%s\n' --regex --glob )" -- "$cur" ) ) ;;
+        --import) COMPREPLY=( $( compgen -f -- "$cur" ) ) ;;
+        --completion-script) COMPREPLY=( $( compgen -W "$( printf '%s\n' bash zsh fish )" -- "$cur" ) ) ;;
+        esac
+    fi
+}
+complete -F _scc scc
+)SCRIPT";
+
+static const char *zshScript = R"SCRIPT(#compdef scc
+
+_scc()
+{
+    local -a results
+    if (( CURRENT == 2 )); then
+        compadd -- connect --list --import --daemon --completion-script --help
+    elif (( CURRENT == 3 )); then
+        case $words[2] in
+        connect) results=( ${(f)"$( scc --complete name "$PREFIX" )"} ); compadd -a results ;;
+        --list) [[ $PREFIX == -* ]] && compadd -- --regex --glob ;;
+        --import) _files ;;
+        --completion-script) compadd -- bash zsh fish ;;
+        esac
+    fi
+}
+
+if [ "$funcstack[1]" = "_scc" ]; then
+    _scc "$@"
+else
+    compdef _scc scc
+fi
+)SCRIPT";
+
+static const char *fishScript = R"SCRIPT(complete -c scc -f
+complete -c scc -n 'test (count (commandline -opc)) -eq 1' -a 'connect --list --import --daemon --completion-script --help'
+complete -c scc -n 'test (count (commandline -opc)) -eq 2; and test (commandline -opc)[2] = connect' -a '(scc --complete name (commandline -ct))'
+complete -c scc -n 'test (count (commandline -opc)) -eq 2; and test (commandline -opc)[2] = --list' -a '--regex --glob'
+complete -c scc -n 'test (count (commandline -opc)) -eq 2; and test (commandline -opc)[2] = --import' -F
+complete -c scc -n 'test (count (commandline -opc)) -eq 2; and test (commandline -opc)[2] = --completion-script' -a 'bash zsh fish'
+)SCRIPT";
+
+/** END completion scripts **/
+
+
+/** BEGIN COMPLETIONCACHE **/
+
+CompletionCache::CompletionCache()
+    :   data( NULL ),
+        length( 0 )
+{
+}
+
+CompletionCache::~CompletionCache()
+{
+    if ( data != NULL ) {
+        munmap( (void*)data, length );
+    }
+}
+
+std::string CompletionCache::getCachePath()
+{
+    const char *home_path = getenv( "HOME" );
+    return std::string( home_path != NULL ? home_path : "" ) + "/.scc/completions";
+}
+
+const char* CompletionCache::getScript( std::string_view shell )
+{
+    if ( shell == "bash" ) {
+        return bashScript;
+    } else if ( shell == "zsh" ) {
+        return zshScript;
+    } else if ( shell == "fish" ) {
+        return fishScript;
+    }
+    return NULL;
+}
+
+bool CompletionCache::open()
+{
+    // a missing file is reported, an empty one is simply nothing to offer
+    int fd = ::open( getCachePath().c_str(), O_RDONLY );
+    if ( fd < 0 ) {
+        return false;
+    }
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 ) {
+        close( fd );
+        return false;
+    }
+    if ( st.st_size > 0 ) {
+        void *mapped = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( mapped == MAP_FAILED ) {
+            close( fd );
+            return false;
+        }
+        data = (const char*)mapped;
+        length = st.st_size;
+    }
+    close( fd );
+    return true;
+}
+
+size_t CompletionCache::findFirst( std::string_view key ) const
+{
+    // offset of the first line not below key, low and high always sit on
+    // line starts, everything before low is below key, nothing from high on is
+    size_t low = 0;
+    size_t high = length;
+    while ( low < high ) {
+        size_t start = low + ( high - low ) / 2;
+        while ( start > low && data[ start - 1 ] != '\n' ) {
+            start--;
+        }
+        const char *newline = (const char*)memchr( data + start, '\n', length - start );
+        size_t end = newline != NULL ? newline - data : length;
+        if ( std::string_view( data + start, end - start ) < key ) {
+            low = end + 1;
+        } else {
+            high = start;
+        }
+    }
+    return low;
+}
+
+std::vector< std::string_view > CompletionCache::complete( CompletionKind kind, std::string_view prefix, size_t limit ) const
+{
+    std::vector< std::string_view > retval;
+    if ( data == NULL ) {
+        return retval;
+    }
+    std::string key( 1, kind == COMPLETE_GROUP ? 'g' : 'n' );
+    key.push_back( '\t' );
+    key.append( prefix.data(), prefix.length() );
+    size_t start = findFirst( key );
+    while ( start < length && retval.size() < limit ) {
+        const char *newline = (const char*)memchr( data + start, '\n', length - start );
+        size_t end = newline != NULL ? newline - data : length;
+        std::string_view line( data + start, end - start );
+        if ( line.compare( 0, key.length(), key ) != 0 ) {
+            break;
+        }
+        retval.push_back( line.substr( 2 ) );
+        start = end + 1;
+    }
+    return retval;
+}
+
+bool CompletionCache::write( const ConnectionTable &snapshot )
+{
+    std::vector< std::string > lines;
+    std::unordered_set< std::string > groups;
+    lines.reserve( snapshot.size() );
+    for ( ConnectionTable::const_iterator it = snapshot.begin(); it != snapshot.end(); ++it ) {
+        // a newline in a name would split its line in two
+        if ( (*it)->isShadowed() == true || (*it)->getName().find( '\n' ) != std::string::npos ) {
+            continue;
+        }
+        lines.push_back( "n\t" + (*it)->getName() );
+        if ( (*it)->getGroup().empty() == false ) {
+            groups.insert( (*it)->getGroup() );
+        }
+    }
+    // every parent as well, so "prod/" can be completed on to "prod/eu"
+    for ( std::unordered_set< std::string >::iterator it = groups.begin(); it != groups.end(); ++it ) {
+        for ( size_t slash = it->find( '/', 1 ); slash != std::string::npos; slash = it->find( '/', slash + 1 ) ) {
+            lines.push_back( "g\t" + it->substr( 0, slash ) );
+        }
+        lines.push_back( "g\t" + (*it) );
+    }
+    std::sort( lines.begin(), lines.end() );
+    lines.erase( std::unique( lines.begin(), lines.end() ), lines.end() );
+
+    // the daemon, the UI and provider threads may all write, each through its own temporary
+    static std::atomic< unsigned int > sequence( 0 );
+    std::stringstream temp;
+    temp << getCachePath() << "." << getpid() << "." << sequence++;
+    std::ofstream ofs( temp.str().c_str(), std::ofstream::out | std::ofstream::binary );
+    if ( ofs.is_open() == false ) {
+        return false;
+    }
+    for ( std::vector< std::string >::iterator it = lines.begin(); it != lines.end(); ++it ) {
+        ofs << (*it) << '\n';
+    }
+    ofs.close();
+    if ( ofs.fail() == true || rename( temp.str().c_str(), getCachePath().c_str() ) != 0 ) {
+        unlink( temp.str().c_str() );
+        return false;
+    }
+    return true;
+}
+
+bool CompletionCache::isStale( const std::vector< std::string > &sources )
+{
+    struct stat cache;
+    if ( stat( getCachePath().c_str(), &cache ) != 0 ) {
+        return true;
+    }
+    for ( std::vector< std::string >::const_iterator it = sources.begin(); it != sources.end(); ++it ) {
+        struct stat st;
+        if ( stat( it->c_str(), &st ) == 0 && ( st.st_mtim.tv_sec > cache.st_mtim.tv_sec
+                || ( st.st_mtim.tv_sec == cache.st_mtim.tv_sec && st.st_mtim.tv_nsec > cache.st_mtim.tv_nsec ) ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** END COMPLETIONCACHE **/
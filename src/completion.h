@@ -0,0 +1,70 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#ifndef __COMPLETION__H_
+#define __COMPLETION__H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ConnectionTable;
+
+enum CompletionKind
+{
+    COMPLETE_NAME,
+    COMPLETE_GROUP
+};
+
+/**
+    Names and groups for shell completion, kept in ~/.scc/completions so a
+    TAB press never has to load the database.
+
+    The file is plain sorted lines, "g\t<group>" then "n\t<name>", every
+    parent of a group listed too. A lookup maps it and binary searches for
+    the first line carrying the prefix, the way look(1) does, then reads
+    forward while the prefix holds. SSHDatabase rewrites it on a thread of
+    its own after the database is written, and when a load finds it older
+    than the layers.
+**/
+class CompletionCache
+{
+public:
+    CompletionCache();
+    ~CompletionCache();
+
+    bool open();
+    std::vector< std::string_view > complete( CompletionKind kind, std::string_view prefix, size_t limit ) const;
+
+    static bool write( const ConnectionTable &snapshot );
+    static bool isStale( const std::vector< std::string > &sources );
+    static std::string getCachePath();
+    static const char* getScript( std::string_view shell );
+
+private:
+    size_t findFirst( std::string_view key ) const;
+
+    const char *data;
+    size_t length;
+};
+
+#endif
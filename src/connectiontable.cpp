@@ -0,0 +1,276 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "connectiontable.h"
+#include "sshdatabase.h"
+
+/** BEGIN CONST_ITERATOR **/
+
+Connection* ConnectionTable::const_iterator::operator*() const
+{
+    return path.back()->value.get();
+}
+
+void ConnectionTable::const_iterator::descend( const Node *node )
+{
+    while ( node != NULL ) {
+        path.push_back( node );
+        node = node->left.get();
+    }
+}
+
+ConnectionTable::const_iterator& ConnectionTable::const_iterator::operator++()
+{
+    // in order walk, the path holds the nodes still waiting for their turn
+    const Node *node = path.back();
+    path.pop_back();
+    descend( node->right.get() );
+    return *this;
+}
+
+bool ConnectionTable::const_iterator::operator==( const const_iterator &other ) const
+{
+    if ( path.empty() == true || other.path.empty() == true ) {
+        return path.empty() == other.path.empty();
+    }
+    return path.back() == other.path.back();
+}
+
+bool ConnectionTable::const_iterator::operator!=( const const_iterator &other ) const
+{
+    return ( *this == other ) == false;
+}
+
+/** END CONST_ITERATOR **/
+
+
+/** BEGIN CONNECTIONTABLE **/
+
+ConnectionTable::ConnectionTable()
+{
+}
+
+ConnectionTable::ConnectionTable( NodePtr root )
+    :   root( root )
+{
+}
+
+size_t ConnectionTable::size() const
+{
+    return root != NULL ? root->size : 0;
+}
+
+bool ConnectionTable::empty() const
+{
+    return root == NULL;
+}
+
+ConnectionTable::const_iterator ConnectionTable::begin() const
+{
+    const_iterator it;
+    it.descend( root.get() );
+    return it;
+}
+
+ConnectionTable::const_iterator ConnectionTable::end() const
+{
+    return const_iterator();
+}
+
+std::shared_ptr< Connection > ConnectionTable::get( unsigned long long id ) const
+{
+    const Node *node = root.get();
+    while ( node != NULL && node->key != id ) {
+        node = id < node->key ? node->left.get() : node->right.get();
+    }
+    return node != NULL ? node->value : std::shared_ptr< Connection >();
+}
+
+Connection* ConnectionTable::find( unsigned long long id ) const
+{
+    return get( id ).get();
+}
+
+Connection* ConnectionTable::findNext( unsigned long long id ) const
+{
+    const Node *node = root.get();
+    const Node *next = NULL;
+    while ( node != NULL ) {
+        if ( node->key > id ) {
+            next = node;
+            node = node->left.get();
+        } else {
+            node = node->right.get();
+        }
+    }
+    return next != NULL ? next->value.get() : NULL;
+}
+
+unsigned long long ConnectionTable::getLastId() const
+{
+    const Node *node = root.get();
+    while ( node != NULL && node->right != NULL ) {
+        node = node->right.get();
+    }
+    return node != NULL ? node->key : 0;
+}
+
+void ConnectionTable::collect( Predicate predicate, const void *context, std::vector< Connection* > &out ) const
+{
+    // walks the table without an iterator, so a scan allocates nothing
+    // beyond what out needs to grow
+    collect( root.get(), predicate, context, out );
+}
+
+void ConnectionTable::collect( const Node *node, Predicate predicate, const void *context, std::vector< Connection* > &out )
+{
+    // recurse left, loop right, the stack only grows with the left depth
+    while ( node != NULL ) {
+        collect( node->left.get(), predicate, context, out );
+        if ( predicate( node->value.get(), context ) == true ) {
+            out.push_back( node->value.get() );
+        }
+        node = node->right.get();
+    }
+}
+
+unsigned int ConnectionTable::hash( unsigned long long key )
+{
+    // splitmix64 finalizer, ids are sequential and need scattering
+    key += 0x9e3779b97f4a7c15ULL;
+    key = ( key ^ ( key >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    key = ( key ^ ( key >> 27 ) ) * 0x94d049bb133111ebULL;
+    return (unsigned int)( key ^ ( key >> 31 ) );
+}
+
+ConnectionTable::NodePtr ConnectionTable::make( const Node *from, NodePtr left, NodePtr right )
+{
+    std::shared_ptr< Node > node = std::make_shared< Node >();
+    node->value = from->value;
+    node->key = from->key;
+    node->priority = from->priority;
+    node->size = 1 + ( left != NULL ? left->size : 0 ) + ( right != NULL ? right->size : 0 );
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+ConnectionTable::NodePtr ConnectionTable::merge( const NodePtr &left, const NodePtr &right )
+{
+    // every key in left is below every key in right
+    if ( left == NULL ) {
+        return right;
+    }
+    if ( right == NULL ) {
+        return left;
+    }
+    if ( left->priority > right->priority ) {
+        return make( left.get(), left->left, merge( left->right, right ) );
+    }
+    return make( right.get(), merge( left, right->left ), right->right );
+}
+
+std::pair< ConnectionTable::NodePtr, ConnectionTable::NodePtr > ConnectionTable::split( const NodePtr &node, unsigned long long key )
+{
+    // keys below key go left, the rest right, only the path to key is copied
+    if ( node == NULL ) {
+        return std::make_pair( NodePtr(), NodePtr() );
+    }
+    if ( node->key < key ) {
+        std::pair< NodePtr, NodePtr > parts = split( node->right, key );
+        return std::make_pair( make( node.get(), node->left, parts.first ), parts.second );
+    }
+    std::pair< NodePtr, NodePtr > parts = split( node->left, key );
+    return std::make_pair( parts.first, make( node.get(), parts.second, node->right ) );
+}
+
+ConnectionTable ConnectionTable::insert( const std::shared_ptr< Connection > &connection ) const
+{
+    unsigned long long key = connection->getId();
+    std::shared_ptr< Node > node = std::make_shared< Node >();
+    node->value = connection;
+    node->key = key;
+    node->priority = hash( key );
+    node->size = 1;
+
+    // replaces whatever had the same id
+    std::pair< NodePtr, NodePtr > below = split( root, key );
+    std::pair< NodePtr, NodePtr > above = split( below.second, key + 1 );
+    return ConnectionTable( merge( merge( below.first, node ), above.second ) );
+}
+
+ConnectionTable ConnectionTable::append( const std::vector< std::shared_ptr< Connection > > &batch ) const
+{
+    // ids are increasing and above ours, build the batch as its own treap
+    // in one pass over a right spine and merge it on in O(log n)
+    std::vector< std::shared_ptr< Node > > spine;
+    for ( std::vector< std::shared_ptr< Connection > >::const_iterator it = batch.begin(); it != batch.end(); ++it ) {
+        std::shared_ptr< Node > node = std::make_shared< Node >();
+        node->value = (*it);
+        node->key = (*it)->getId();
+        node->priority = hash( node->key );
+        node->size = 1;
+        std::shared_ptr< Node > last;
+        while ( spine.empty() == false && spine.back()->priority < node->priority ) {
+            last = spine.back();
+            spine.pop_back();
+            // popped nodes are complete, their sizes are final
+            last->size = 1 + ( last->left != NULL ? last->left->size : 0 ) + ( last->right != NULL ? last->right->size : 0 );
+        }
+        node->left = last;
+        if ( spine.empty() == false ) {
+            spine.back()->right = node;
+        }
+        spine.push_back( node );
+    }
+    while ( spine.empty() == false ) {
+        std::shared_ptr< Node > last = spine.back();
+        last->size = 1 + ( last->left != NULL ? last->left->size : 0 ) + ( last->right != NULL ? last->right->size : 0 );
+        if ( spine.size() == 1 ) {
+            return ConnectionTable( merge( root, last ) );
+        }
+        spine.pop_back();
+    }
+    return *this;
+}
+
+ConnectionTable ConnectionTable::erase( unsigned long long id ) const
+{
+    std::pair< NodePtr, NodePtr > below = split( root, id );
+    std::pair< NodePtr, NodePtr > above = split( below.second, id + 1 );
+    if ( above.first == NULL ) {
+        return *this;
+    }
+    return ConnectionTable( merge( below.first, above.second ) );
+}
+
+ConnectionTable ConnectionTable::acquire() const
+{
+    return ConnectionTable( std::atomic_load_explicit( &root, std::memory_order_acquire ) );
+}
+
+void ConnectionTable::publish( const ConnectionTable &next )
+{
+    // the whole version becomes visible at once, readers see old or new
+    std::atomic_store_explicit( &root, next.root, std::memory_order_release );
+}
+
+/** END CONNECTIONTABLE **/
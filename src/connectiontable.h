@@ -0,0 +1,107 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __CONNECTION_TABLE__H_
+#define __CONNECTION_TABLE__H_
+
+#include <memory>
+#include <vector>
+#include <utility>
+
+class Connection;
+
+/**
+    An immutable table of connections ordered by their id. Every change
+    returns a new table that shares all untouched nodes with the old one,
+    so a change costs O(log n) and keeping old versions around is cheap.
+
+    It is a treap whose priorities are a hash of the id, which keeps it
+    balanced without any rebalancing state and lets a batch of increasing
+    ids be built in one pass.
+
+    A table shared between threads is read with acquire() and replaced
+    with publish(). Readers never wait, whatever they acquired stays alive
+    until they drop it, nodes and connections are reference counted.
+**/
+class ConnectionTable
+{
+private:
+    struct Node
+    {
+        std::shared_ptr< Connection > value;
+        unsigned long long key;
+        unsigned int priority;
+        size_t size;
+        std::shared_ptr< const Node > left;
+        std::shared_ptr< const Node > right;
+    };
+    typedef std::shared_ptr< const Node > NodePtr;
+
+public:
+    class const_iterator
+    {
+    public:
+        Connection* operator*() const;
+        const_iterator& operator++();
+        bool operator!=( const const_iterator &other ) const;
+        bool operator==( const const_iterator &other ) const;
+
+    private:
+        friend class ConnectionTable;
+        void descend( const Node *node );
+        std::vector< const Node* > path;
+    };
+
+    // decides what collect() keeps, context is handed through untouched
+    typedef bool (*Predicate)( const Connection *connection, const void *context );
+
+    ConnectionTable();
+
+    size_t size() const;
+    bool empty() const;
+    const_iterator begin() const;
+    const_iterator end() const;
+    Connection* find( unsigned long long id ) const;
+    Connection* findNext( unsigned long long id ) const;
+    std::shared_ptr< Connection > get( unsigned long long id ) const;
+    unsigned long long getLastId() const;
+    void collect( Predicate predicate, const void *context, std::vector< Connection* > &out ) const;
+
+    ConnectionTable insert( const std::shared_ptr< Connection > &connection ) const;
+    ConnectionTable append( const std::vector< std::shared_ptr< Connection > > &batch ) const;
+    ConnectionTable erase( unsigned long long id ) const;
+
+    ConnectionTable acquire() const;
+    void publish( const ConnectionTable &next );
+
+private:
+    ConnectionTable( NodePtr root );
+
+    static unsigned int hash( unsigned long long key );
+    static NodePtr make( const Node *from, NodePtr left, NodePtr right );
+    static NodePtr merge( const NodePtr &left, const NodePtr &right );
+    static std::pair< NodePtr, NodePtr > split( const NodePtr &node, unsigned long long key );
+    static void collect( const Node *node, Predicate predicate, const void *context, std::vector< Connection* > &out );
+
+    NodePtr root;
+};
+
+#endif
@@ -0,0 +1,174 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#include "cursesrenderer.h"
+#include "unicode.h"
+#include <wctype.h>
+
+/** BEGIN CURSESRENDERER **/
+
+CursesRenderer::CursesRenderer()
+{
+    initscr();
+    noecho();
+    start_color();
+    // one color pair per style, STYLE_NORMAL is pair 0
+    init_pair( STYLE_ACCENT, COLOR_YELLOW, COLOR_BLACK );
+    init_pair( STYLE_GROUP, COLOR_BLUE, COLOR_BLACK );
+    init_pair( STYLE_MARKED, COLOR_GREEN, COLOR_BLACK );
+}
+
+CursesRenderer::~CursesRenderer()
+{
+    for ( std::vector< WINDOW* >::iterator it = windows.begin(); it != windows.end(); ++it ) {
+        if ( (*it) != NULL ) {
+            delwin( *it );
+        }
+    }
+    ::refresh();
+    endwin();
+}
+
+attr_t CursesRenderer::getAttributes( unsigned int style )
+{
+    attr_t attributes = COLOR_PAIR( style & ~STYLE_BOLD );
+    if ( ( style & STYLE_BOLD ) != 0 ) {
+        attributes |= A_BOLD;
+    }
+    return attributes;
+}
+
+void CursesRenderer::getSize( int &rows, int &columns ) const
+{
+    getmaxyx( stdscr, rows, columns );
+}
+
+int CursesRenderer::createPanel( int rows, int columns, int y, int x )
+{
+    WINDOW *window = newwin( rows, columns, y, x );
+    keypad( window, true );
+    // reuse the slot of a destroyed panel, dialogs come and go
+    for ( size_t i = 0; i < windows.size(); i++ ) {
+        if ( windows[ i ] == NULL ) {
+            windows[ i ] = window;
+            return i;
+        }
+    }
+    windows.push_back( window );
+    return windows.size() - 1;
+}
+
+void CursesRenderer::destroyPanel( int panel )
+{
+    delwin( windows[ panel ] );
+    windows[ panel ] = NULL;
+}
+
+void CursesRenderer::getPanelSize( int panel, int &rows, int &columns ) const
+{
+    getmaxyx( windows[ panel ], rows, columns );
+}
+
+void CursesRenderer::clearPanel( int panel )
+{
+    // unlike wclear this leaves it to curses to send only what changed
+    werase( windows[ panel ] );
+}
+
+void CursesRenderer::drawBorder( int panel )
+{
+    ::box( windows[ panel ], 0, 0 );
+}
+
+int CursesRenderer::print( int panel, int row, int x, std::string_view text, unsigned int style )
+{
+    // cut at the edge of the panel instead of wrapping onto the next row
+    WINDOW *window = windows[ panel ];
+    if ( row < 0 || row >= getmaxy( window ) || x < 0 || x >= getmaxx( window ) ) {
+        return x;
+    }
+    size_t length = Unicode::fit( text, getmaxx( window ) - x );
+    attr_t attributes = getAttributes( style );
+    wattron( window, attributes );
+    mvwaddnstr( window, row, x, text.data(), length );
+    wattroff( window, attributes );
+    return x + Unicode::width( text.substr( 0, length ) );
+}
+
+void CursesRenderer::moveCursor( int panel, int row, int x )
+{
+    wmove( windows[ panel ], row, x );
+}
+
+void CursesRenderer::refreshPanel( int panel )
+{
+    wnoutrefresh( windows[ panel ] );
+}
+
+void CursesRenderer::update()
+{
+    doupdate();
+}
+
+bool CursesRenderer::readInput( int panel, int timeout, int &c )
+{
+    // characters come back as text and control codes as keys, function
+    // keys are translated to ours and the ones Window has no use for
+    // are dropped
+    wtimeout( windows[ panel ], timeout );
+    wint_t wc = 0;
+    int result = wget_wch( windows[ panel ], &wc );
+    if ( result == OK ) {
+        c = wc;
+        return iswprint( wc ) != 0;
+    }
+    c = result == KEY_CODE_YES ? translateKey( wc ) : INPUT_NONE;
+    return false;
+}
+
+int CursesRenderer::translateKey( int key )
+{
+    switch ( key ) {
+    case KEY_UP:
+        return K_UP;
+    case KEY_DOWN:
+        return K_DOWN;
+    case KEY_LEFT:
+        return K_LEFT;
+    case KEY_RIGHT:
+        return K_RIGHT;
+    case KEY_BTAB:
+        return K_BTAB;
+    case KEY_ENTER:
+        return K_ENTER;
+    case KEY_BACKSPACE:
+        return K_BACKSPACE;
+    }
+    return INPUT_NONE;
+}
+
+void CursesRenderer::beep()
+{
+    ::beep();
+}
+
+/** END CURSESRENDERER **/
@@ -0,0 +1,59 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#ifndef __CURSES_RENDERER__H_
+#define __CURSES_RENDERER__H_
+
+#include <vector>
+#include <ncursesw/curses.h>
+#include "renderer.h"
+
+/**
+    Draws on the terminal with ncurses, every panel is a curses window.
+**/
+class CursesRenderer : public Renderer
+{
+public:
+    CursesRenderer();
+    ~CursesRenderer();
+
+    void getSize( int &rows, int &columns ) const;
+    int createPanel( int rows, int columns, int y, int x );
+    void destroyPanel( int panel );
+    void getPanelSize( int panel, int &rows, int &columns ) const;
+    void clearPanel( int panel );
+    void drawBorder( int panel );
+    int print( int panel, int row, int x, std::string_view text, unsigned int style );
+    void moveCursor( int panel, int row, int x );
+    void refreshPanel( int panel );
+    void update();
+    bool readInput( int panel, int timeout, int &c );
+    void beep();
+
+private:
+    static attr_t getAttributes( unsigned int style );
+    static int translateKey( int key );
+
+    std::vector< WINDOW* > windows;
+};
+
+#endif
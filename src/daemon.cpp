@@ -0,0 +1,464 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "daemon.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <sstream>
+
+// neither end waits longer than this on a stalled peer, the client loads
+// the database itself instead and the daemon moves on to the next client
+#define SOCKET_TIMEOUT_MS 200
+
+/** BEGIN wire helpers **/
+
+static bool writeAll( int fd, const char *data, size_t length )
+{
+    while ( length > 0 ) {
+        ssize_t n = write( fd, data, length );
+        if ( n < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+static long long getMilliseconds()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void setTimeouts( int fd )
+{
+    // every blocking read, write and connect gives up with EAGAIN
+    struct timeval tv;
+    tv.tv_sec = SOCKET_TIMEOUT_MS / 1000;
+    tv.tv_usec = ( SOCKET_TIMEOUT_MS % 1000 ) * 1000;
+    setsockopt( fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof( tv ) );
+    setsockopt( fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof( tv ) );
+}
+
+static bool readAll( int fd, char *data, size_t length, long long deadline )
+{
+    // the socket timeout bounds each read, the deadline the whole request
+    // so a client trickling in a byte at a time is dropped as well
+    while ( length > 0 ) {
+        if ( getMilliseconds() > deadline ) {
+            return false;
+        }
+        ssize_t n = read( fd, data, length );
+        if ( n < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( n <= 0 ) {
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+static void appendField( std::string &out, const std::string &field )
+{
+    uint16_t length = field.length() > 0xffff ? 0xffff : field.length();
+    out.append( (const char*)&length, sizeof( length ) );
+    out.append( field, 0, length );
+}
+
+static void appendRecords( std::string &out, const std::vector< Connection* > &records, SSHDatabase *database )
+{
+    uint32_t count = records.size();
+    out.append( (const char*)&count, sizeof( count ) );
+    for ( std::vector< Connection* >::const_iterator it = records.begin(); it != records.end(); ++it ) {
+        appendField( out, (*it)->getName() );
+        appendField( out, (*it)->getHostname() );
+        appendField( out, (*it)->getGroup() );
+        appendField( out, (*it)->getUser() );
+        appendField( out, (*it)->getPassword() );
+        appendField( out, (*it)->getSource() );
+        appendField( out, database->getLayerPath( (*it)->getLayer() ) );
+    }
+}
+
+static bool takeField( const std::string &buffer, size_t &pos, std::string &field )
+{
+    // false when the field has not fully arrived yet, pos is left alone
+    uint16_t length;
+    if ( pos + sizeof( length ) > buffer.length() ) {
+        return false;
+    }
+    memcpy( &length, buffer.data() + pos, sizeof( length ) );
+    if ( pos + sizeof( length ) + length > buffer.length() ) {
+        return false;
+    }
+    field.assign( buffer, pos + sizeof( length ), length );
+    pos += sizeof( length ) + length;
+    return true;
+}
+
+static int connectSocket()
+{
+    std::string path = DaemonClient::getSocketPath();
+    struct sockaddr_un addr;
+    if ( path.length() >= sizeof( addr.sun_path ) ) {
+        return -1;
+    }
+    int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0 ) {
+        return -1;
+    }
+    setTimeouts( fd );
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, path.c_str() );
+    if ( connect( fd, (struct sockaddr*)&addr, sizeof( addr ) ) != 0 ) {
+        close( fd );
+        return -1;
+    }
+    return fd;
+}
+
+/** END wire helpers **/
+
+
+/** BEGIN DATABASEDAEMON **/
+
+DatabaseDaemon::DatabaseDaemon()
+    :   database( NULL ),
+        listenFd( -1 )
+{
+}
+
+DatabaseDaemon::~DatabaseDaemon()
+{
+    if ( listenFd >= 0 ) {
+        close( listenFd );
+        unlink( DaemonClient::getSocketPath().c_str() );
+    }
+    delete database;
+}
+
+bool DatabaseDaemon::openSocket()
+{
+    std::string path = DaemonClient::getSocketPath();
+    struct sockaddr_un addr;
+    if ( path.length() >= sizeof( addr.sun_path ) ) {
+        fprintf( stderr, "scc: socket path too long: %s\n", path.c_str() );
+        return false;
+    }
+
+    // refuse to steal the socket from a daemon that is still answering
+    if ( DaemonClient::ping() == true ) {
+        fprintf( stderr, "scc: daemon already running on %s\n", path.c_str() );
+        return false;
+    }
+    unlink( path.c_str() );
+
+    listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( listenFd < 0 ) {
+        perror( "scc: socket" );
+        return false;
+    }
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, path.c_str() );
+    mode_t oldMask = umask( 0077 );
+    int rc = bind( listenFd, (struct sockaddr*)&addr, sizeof( addr ) );
+    umask( oldMask );
+    if ( rc != 0 || listen( listenFd, 16 ) != 0 ) {
+        perror( "scc: bind" );
+        close( listenFd );
+        listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+void DatabaseDaemon::rebuildSnapshot()
+{
+    // hidden records too, the client works out shadowing against its own writable layer
+    std::vector< Connection* > records;
+    ConnectionTable version = database->getSnapshot();
+    for ( ConnectionTable::const_iterator it = version.begin(); it != version.end(); ++it ) {
+        if ( (*it)->isReadOnly() == true ) {
+            records.push_back( *it );
+        }
+    }
+    snapshot.clear();
+    appendRecords( snapshot, records, database );
+}
+
+void DatabaseDaemon::reloadIfChanged()
+{
+    // any layer changing, or the list of layers itself, means a reload
+    std::vector< std::string > paths;
+    paths.push_back( Layer::getSourcesPath() );
+    std::vector< Layer > layers = Layer::loadSources();
+    for ( std::vector< Layer >::iterator it = layers.begin(); it != layers.end(); ++it ) {
+        paths.push_back( it->getPath() );
+    }
+    std::ostringstream signature;
+    for ( std::vector< std::string >::iterator it = paths.begin(); it != paths.end(); ++it ) {
+        struct stat st;
+        memset( &st, 0, sizeof( st ) );
+        stat( it->c_str(), &st );
+        signature << st.st_mtim.tv_sec << '.' << st.st_mtim.tv_nsec << ':' << st.st_size << ';';
+    }
+    if ( database != NULL && signature.str() == databaseSignature ) {
+        return;
+    }
+    databaseSignature = signature.str();
+
+    if ( database == NULL ) {
+        database = new SSHDatabase();
+    }
+    database->loadDatabase( false );
+    rebuildSnapshot();
+}
+
+void DatabaseDaemon::serveClient( int fd )
+{
+    // a client that stalls is dropped, everyone else is waiting behind it
+    setTimeouts( fd );
+    long long deadline = getMilliseconds() + SOCKET_TIMEOUT_MS;
+    uint8_t op;
+    uint32_t length;
+    if ( readAll( fd, (char*)&op, sizeof( op ), deadline ) == false
+            || readAll( fd, (char*)&length, sizeof( length ), deadline ) == false
+            || length > 65536 ) {
+        return;
+    }
+    std::string payload( length, '\0' );
+    if ( length > 0 && readAll( fd, &payload[ 0 ], length, deadline ) == false ) {
+        return;
+    }
+
+    switch ( op ) {
+    case DAEMON_OP_SNAPSHOT:
+        writeAll( fd, snapshot.data(), snapshot.length() );
+        break;
+    case DAEMON_OP_QUERY: {
+        std::string reply;
+        if ( payload.empty() == false ) {
+            // an unknown mode gets no reply at all, the client reads that as a failure
+            uint8_t mode = payload[ 0 ];
+            if ( mode != SEARCH_TEXT && mode != SEARCH_REGEX && mode != SEARCH_GLOB ) {
+                break;
+            }
+            appendRecords( reply, database->search( payload.substr( 1 ), (SearchMode)mode ), database );
+        } else {
+            appendRecords( reply, database->search( "" ), database );
+        }
+        writeAll( fd, reply.data(), reply.length() );
+        break;
+    }
+    case DAEMON_OP_PING: {
+        uint32_t count = 0;
+        writeAll( fd, (const char*)&count, sizeof( count ) );
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+int DatabaseDaemon::run( bool detach )
+{
+    signal( SIGPIPE, SIG_IGN );
+    if ( openSocket() == false ) {
+        return 1;
+    }
+    reloadIfChanged();
+    if ( detach == true && daemon( 1, 0 ) != 0 ) {
+        perror( "scc: daemon" );
+        return 1;
+    }
+
+    for(;;) {
+        struct pollfd pfd;
+        pfd.fd = listenFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        // wake up every second to pick up changes to the database file
+        int rc = poll( &pfd, 1, 1000 );
+        if ( rc < 0 && errno != EINTR ) {
+            perror( "scc: poll" );
+            return 1;
+        }
+        reloadIfChanged();
+        if ( database->pollProviders() == true ) {
+            rebuildSnapshot();
+        }
+        if ( rc > 0 && ( pfd.revents & POLLIN ) ) {
+            int fd = accept( listenFd, NULL, NULL );
+            if ( fd >= 0 ) {
+                serveClient( fd );
+                close( fd );
+            }
+        }
+    }
+    return 0;
+}
+
+/** END DATABASEDAEMON **/
+
+
+/** BEGIN DAEMONCLIENT **/
+
+DaemonClient::DaemonClient()
+    :   fd( -1 ),
+        count( 0 ),
+        decoded( 0 ),
+        counted( false )
+{
+}
+
+DaemonClient::~DaemonClient()
+{
+    if ( fd >= 0 ) {
+        close( fd );
+    }
+}
+
+std::string DaemonClient::getSocketPath()
+{
+    const char *home_path = getenv( "HOME" );
+    return std::string( home_path != NULL ? home_path : "" ) + "/.scc/daemon.sock";
+}
+
+bool DaemonClient::ping()
+{
+    std::vector< Connection* > unused;
+    return fetch( DAEMON_OP_PING, "", unused );
+}
+
+bool DaemonClient::fetch( uint8_t op, const std::string &payload, std::vector< Connection* > &result )
+{
+    DaemonClient client;
+    if ( client.request( op, payload ) == false ) {
+        return false;
+    }
+    std::vector< std::string > layers;
+    size_t first = result.size();
+    while ( client.isDone() == false ) {
+        if ( client.readBatch( result, layers ) == false ) {
+            // truncated reply, drop what we decoded so far
+            for ( size_t r = first; r < result.size(); r++ ) {
+                delete result[ r ];
+            }
+            result.resize( first );
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DaemonClient::request( uint8_t op, const std::string &payload )
+{
+    fd = connectSocket();
+    if ( fd < 0 ) {
+        return false;
+    }
+    std::string message;
+    uint32_t length = payload.length();
+    message.append( (const char*)&op, sizeof( op ) );
+    message.append( (const char*)&length, sizeof( length ) );
+    message.append( payload );
+    return writeAll( fd, message.data(), message.length() );
+}
+
+bool DaemonClient::isDone() const
+{
+    return counted == true && decoded == count;
+}
+
+uint32_t DaemonClient::getCount() const
+{
+    return count;
+}
+
+bool DaemonClient::readBatch( std::vector< Connection* > &batch, std::vector< std::string > &layers )
+{
+    // one read at most, a daemon that stops sending times out and the
+    // caller loads locally, the end of the stream before the last record is an error
+    char chunk[ 65536 ];
+    ssize_t n;
+    do {
+        n = read( fd, chunk, sizeof( chunk ) );
+    } while ( n < 0 && errno == EINTR );
+    if ( n <= 0 ) {
+        return false;
+    }
+    buffer.append( chunk, n );
+    decode( batch, layers );
+    return true;
+}
+
+void DaemonClient::decode( std::vector< Connection* > &batch, std::vector< std::string > &layers )
+{
+    size_t pos = 0;
+    if ( counted == false ) {
+        if ( buffer.length() < sizeof( count ) ) {
+            return;
+        }
+        memcpy( &count, buffer.data(), sizeof( count ) );
+        pos = sizeof( count );
+        counted = true;
+    }
+    // whole records only, a record split over two reads waits for the rest
+    std::string fields[ 7 ];
+    while ( decoded < count ) {
+        size_t start = pos;
+        int f = 0;
+        while ( f < 7 && takeField( buffer, pos, fields[ f ] ) == true ) {
+            f++;
+        }
+        if ( f < 7 ) {
+            pos = start;
+            break;
+        }
+        batch.push_back( new Connection( fields[ 0 ], fields[ 1 ], fields[ 2 ], fields[ 3 ], fields[ 4 ] ) );
+        batch.back()->setSource( fields[ 5 ] );
+        layers.push_back( fields[ 6 ] );
+        decoded++;
+    }
+    buffer.erase( 0, pos );
+}
+
+/** END DAEMONCLIENT **/
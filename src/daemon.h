@@ -0,0 +1,102 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __DAEMON__H_
+#define __DAEMON__H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+#include "sshdatabase.h"
+
+/**
+    Wire protocol between scc and the resident index daemon.
+
+    request:  [uint8 op][uint32 length][length bytes of payload]
+              a query payload is [uint8 SearchMode][search text]
+    response: [uint32 count] followed by count records, where each
+              record is seven fields encoded as [uint16 length][bytes]
+              (name, hostname, group, user, password, source, layer),
+              layer being the path of the file the record was read
+              from, empty for provider output.
+
+    A snapshot holds every read-only layer and every provider, hidden
+    records included, so the client can sort out shadowing itself. The
+    writable layer is left out, the client always reads that one from
+    disk, a snapshot may be up to a poll interval behind it.
+
+    All integers are in host byte order, the socket never leaves the machine.
+**/
+#define DAEMON_OP_SNAPSHOT 1
+#define DAEMON_OP_QUERY 2
+#define DAEMON_OP_PING 3
+
+class DatabaseDaemon
+{
+public:
+    DatabaseDaemon();
+    ~DatabaseDaemon();
+
+    int run( bool detach );
+
+private:
+    bool openSocket();
+    void reloadIfChanged();
+    void rebuildSnapshot();
+    void serveClient( int fd );
+
+    SSHDatabase *database;
+    std::string snapshot;
+    int listenFd;
+    std::string databaseSignature;
+};
+
+/**
+    One request to the daemon. The reply is decoded as it arrives, so a
+    large snapshot can be published batch by batch while it streams in.
+**/
+class DaemonClient
+{
+public:
+    DaemonClient();
+    ~DaemonClient();
+
+    bool request( uint8_t op, const std::string &payload );
+    bool readBatch( std::vector< Connection* > &batch, std::vector< std::string > &layers );
+    bool isDone() const;
+    uint32_t getCount() const;
+
+    static std::string getSocketPath();
+    static bool fetch( uint8_t op, const std::string &payload, std::vector< Connection* > &result );
+    static bool ping();
+
+private:
+    void decode( std::vector< Connection* > &batch, std::vector< std::string > &layers );
+
+    int fd;
+    std::string buffer;
+    uint32_t count;
+    uint32_t decoded;
+    bool counted;
+};
+
+#endif
@@ -0,0 +1,237 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "grouptree.h"
+#include "sshdatabase.h"
+#include "unicode.h"
+
+/** BEGIN GROUPNODE **/
+
+GroupNode::GroupNode( std::string name, GroupNode *parent )
+    :   name( name ),
+        parent( parent ),
+        count( 0 )
+{
+    Unicode::fold( name, foldedName );
+}
+
+GroupNode::~GroupNode()
+{
+    for ( std::map< std::string, GroupNode*, std::less<> >::iterator it = children.begin(); it != children.end(); ++it ) {
+        delete it->second;
+    }
+    children.clear();
+}
+
+std::string GroupNode::getName() const
+{
+    return name;
+}
+
+std::string GroupNode::getPath() const
+{
+    if ( parent == NULL ) {
+        return "";
+    }
+    std::string parentPath = parent->getPath();
+    return parentPath.empty() ? name : parentPath + "/" + name;
+}
+
+const std::string& GroupNode::getFoldedName() const
+{
+    return foldedName;
+}
+
+unsigned int GroupNode::getCount() const
+{
+    return count;
+}
+
+GroupNode* GroupNode::getParent() const
+{
+    return parent;
+}
+
+std::vector< GroupNode* > GroupNode::getChildren() const
+{
+    std::vector< GroupNode* > retval;
+    for ( std::map< std::string, GroupNode*, std::less<> >::const_iterator it = children.begin(); it != children.end(); ++it ) {
+        retval.push_back( it->second );
+    }
+    return retval;
+}
+
+void GroupNode::collect( std::vector< Connection* > &out ) const
+{
+    out.insert( out.end(), members.begin(), members.end() );
+    for ( std::map< std::string, GroupNode*, std::less<> >::const_iterator it = children.begin(); it != children.end(); ++it ) {
+        it->second->collect( out );
+    }
+}
+
+/** END GROUPNODE **/
+
+
+/** BEGIN GROUPTREE **/
+
+GroupTree::GroupTree()
+    :   root( new GroupNode( "", NULL ) )
+{
+}
+
+GroupTree::~GroupTree()
+{
+    delete root;
+}
+
+std::vector< std::string > GroupTree::splitPath( std::string path )
+{
+    std::vector< std::string > segments;
+    size_t start = 0;
+    while ( start <= path.length() ) {
+        size_t end = path.find( '/', start );
+        if ( end == std::string::npos ) {
+            end = path.length();
+        }
+        if ( end > start ) {
+            segments.push_back( path.substr( start, end - start ) );
+        }
+        start = end + 1;
+    }
+    return segments;
+}
+
+void GroupTree::add( Connection *connection )
+{
+    std::vector< std::string > segments = splitPath( connection->getGroup() );
+    GroupNode *node = root;
+    node->count++;
+    for ( std::vector< std::string >::iterator it = segments.begin(); it != segments.end(); ++it ) {
+        std::map< std::string, GroupNode*, std::less<> >::iterator child = node->children.find( *it );
+        if ( child == node->children.end() ) {
+            child = node->children.insert( std::make_pair( *it, new GroupNode( *it, node ) ) ).first;
+        }
+        node = child->second;
+        node->count++;
+    }
+    node->positions[ connection ] = node->members.size();
+    node->members.push_back( connection );
+}
+
+void GroupTree::remove( Connection *connection )
+{
+    GroupNode *node = find( connection->getGroup() );
+    if ( node == NULL ) {
+        return;
+    }
+    std::unordered_map< Connection*, size_t >::iterator member = node->positions.find( connection );
+    if ( member == node->positions.end() ) {
+        return;
+    }
+    // the last member takes the place of the removed one, order is sorted out by the caller
+    size_t position = member->second;
+    node->positions.erase( member );
+    if ( position + 1 < node->members.size() ) {
+        node->members[ position ] = node->members.back();
+        node->positions[ node->members[ position ] ] = position;
+    }
+    node->members.pop_back();
+
+    // walk back up, dropping the counts and pruning nodes that went empty
+    while ( node != NULL ) {
+        node->count--;
+        GroupNode *parent = node->parent;
+        if ( node->count == 0 && parent != NULL ) {
+            parent->children.erase( node->name );
+            delete node;
+        }
+        node = parent;
+    }
+}
+
+void GroupTree::clear()
+{
+    delete root;
+    root = new GroupNode( "", NULL );
+}
+
+GroupNode* GroupTree::find( std::string_view path ) const
+{
+    // same segments as splitPath, walked in place since this runs per keystroke
+    GroupNode *node = root;
+    size_t start = 0;
+    while ( node != NULL && start <= path.length() ) {
+        size_t end = path.find( '/', start );
+        if ( end == std::string_view::npos ) {
+            end = path.length();
+        }
+        if ( end > start ) {
+            std::map< std::string, GroupNode*, std::less<> >::const_iterator child = node->children.find( path.substr( start, end - start ) );
+            node = child != node->children.end() ? child->second : NULL;
+        }
+        start = end + 1;
+    }
+    return node;
+}
+
+unsigned int GroupTree::countFolded( std::string_view path ) const
+{
+    return walkFolded( root, path, 0, NULL );
+}
+
+void GroupTree::collectFolded( std::string_view path, std::vector< Connection* > &out ) const
+{
+    walkFolded( root, path, 0, &out );
+}
+
+unsigned int GroupTree::walkFolded( const GroupNode *node, std::string_view path, size_t start, std::vector< Connection* > *out )
+{
+    // every child whose folded name matches the next segment, so the walk
+    // may fan out into several subtrees, adds up their counts
+    while ( start < path.length() && path[ start ] == '/' ) {
+        start++;
+    }
+    if ( start >= path.length() ) {
+        if ( out != NULL ) {
+            node->collect( *out );
+        }
+        return node->count;
+    }
+    size_t end = path.find( '/', start );
+    if ( end == std::string_view::npos ) {
+        end = path.length();
+    }
+    std::string_view segment = path.substr( start, end - start );
+    unsigned int count = 0;
+    for ( std::map< std::string, GroupNode*, std::less<> >::const_iterator it = node->children.begin(); it != node->children.end(); ++it ) {
+        if ( it->second->foldedName == segment ) {
+            count += walkFolded( it->second, path, end, out );
+        }
+    }
+    return count;
+}
+
+GroupNode* GroupTree::getRoot() const
+{
+    return root;
+}
+
+/** END GROUPTREE **/
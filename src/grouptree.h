@@ -0,0 +1,92 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __GROUP_TREE__H_
+#define __GROUP_TREE__H_
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <vector>
+#include <unordered_map>
+
+class Connection;
+
+/**
+    One node per path segment, so "prod/eu/db" lives at root -> prod -> eu -> db.
+    count is the number of connections in this node and all of its
+    descendants, kept up to date on every add and remove.
+
+    Children are keyed by their exact name, "prod" and "Prod" are two
+    nodes. The folded lookups match a folded path against every node
+    whose folded name agrees, the way a group: clause compares groups.
+**/
+class GroupNode
+{
+public:
+    GroupNode( std::string name, GroupNode *parent );
+    ~GroupNode();
+
+    std::string getName() const;
+    const std::string& getFoldedName() const;
+    std::string getPath() const;
+    unsigned int getCount() const;
+    GroupNode* getParent() const;
+    std::vector< GroupNode* > getChildren() const;
+    void collect( std::vector< Connection* > &out ) const;
+
+private:
+    friend class GroupTree;
+
+    std::string name;
+    std::string foldedName;
+    GroupNode *parent;
+    // transparent, so a path can be looked up one segment view at a time
+    std::map< std::string, GroupNode*, std::less<> > children;
+    std::vector< Connection* > members;
+    // where each member sits in members, so a remove is O(1) however big the group
+    std::unordered_map< Connection*, size_t > positions;
+    unsigned int count;
+};
+
+class GroupTree
+{
+public:
+    GroupTree();
+    ~GroupTree();
+
+    void add( Connection *connection );
+    void remove( Connection *connection );
+    void clear();
+    GroupNode* find( std::string_view path ) const;
+    unsigned int countFolded( std::string_view path ) const;
+    void collectFolded( std::string_view path, std::vector< Connection* > &out ) const;
+    GroupNode* getRoot() const;
+
+    static std::vector< std::string > splitPath( std::string path );
+
+private:
+    static unsigned int walkFolded( const GroupNode *node, std::string_view path, size_t start, std::vector< Connection* > *out );
+
+    GroupNode *root;
+};
+
+#endif
@@ -0,0 +1,442 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#include "headlessrenderer.h"
+#include "unicode.h"
+#include <string.h>
+
+/** BEGIN HEADLESSRENDERER **/
+
+HeadlessRenderer::HeadlessRenderer( int rows, int columns )
+    :   rows( rows ),
+        columns( columns ),
+        cursorRow( 0 ),
+        cursorX( 0 ),
+        terminalRow( 0 ),
+        terminalX( 0 ),
+        terminalStyle( STYLE_NORMAL ),
+        frames( 0 ),
+        bytes( 0 ),
+        changedCells( 0 ),
+        scrolledRows( 0 ),
+        beeps( 0 )
+{
+    // the terminal starts out cleared, so does what we think it shows
+    staged.assign( rows * columns, makeCell( " ", 1, STYLE_NORMAL ) );
+    sent = staged;
+}
+
+HeadlessRenderer::~HeadlessRenderer()
+{
+}
+
+HeadlessRenderer::Cell HeadlessRenderer::makeCell( std::string_view glyph, int width, unsigned int style )
+{
+    Cell cell;
+    size_t length = glyph.length();
+    if ( length > CELL_BYTES ) {
+        // drop the marks that do not fit, never half a character
+        length = CELL_BYTES;
+        while ( length > 0 && ( (unsigned char)glyph[ length ] & 0xc0 ) == 0x80 ) {
+            length--;
+        }
+    }
+    memcpy( cell.bytes, glyph.data(), length );
+    cell.length = length;
+    cell.width = width;
+    cell.style = style;
+    return cell;
+}
+
+bool HeadlessRenderer::isSame( const Cell &a, const Cell &b )
+{
+    return a.length == b.length && a.width == b.width && a.style == b.style && memcmp( a.bytes, b.bytes, a.length ) == 0;
+}
+
+size_t HeadlessRenderer::getMoveBytes( int row, int x )
+{
+    // ESC [ row ; column H
+    size_t length = 4;
+    for ( int value = row + 1; value > 0; value /= 10 ) {
+        length++;
+    }
+    for ( int value = x + 1; value > 0; value /= 10 ) {
+        length++;
+    }
+    return length;
+}
+
+size_t HeadlessRenderer::getStyleBytes( unsigned int style )
+{
+    // ESC [ 0 [;1] [;3n] m, reset first and then set what is needed
+    size_t length = 4;
+    if ( ( style & STYLE_BOLD ) != 0 ) {
+        length += 2;
+    }
+    if ( ( style & ~STYLE_BOLD ) != STYLE_NORMAL ) {
+        length += 3;
+    }
+    return length;
+}
+
+void HeadlessRenderer::getSize( int &rows, int &columns ) const
+{
+    rows = this->rows;
+    columns = this->columns;
+}
+
+int HeadlessRenderer::createPanel( int rows, int columns, int y, int x )
+{
+    Panel panel;
+    panel.rows = rows > 0 ? rows : 1;
+    panel.columns = columns > 0 ? columns : 1;
+    panel.y = y;
+    panel.x = x;
+    panel.cursorRow = 0;
+    panel.cursorX = 0;
+    panel.used = true;
+    panel.cells.assign( panel.rows * panel.columns, makeCell( " ", 1, STYLE_NORMAL ) );
+    for ( size_t i = 0; i < panels.size(); i++ ) {
+        if ( panels[ i ].used == false ) {
+            panels[ i ] = panel;
+            return i;
+        }
+    }
+    panels.push_back( panel );
+    return panels.size() - 1;
+}
+
+void HeadlessRenderer::destroyPanel( int panel )
+{
+    panels[ panel ].used = false;
+    panels[ panel ].cells.clear();
+}
+
+void HeadlessRenderer::getPanelSize( int panel, int &rows, int &columns ) const
+{
+    rows = panels[ panel ].rows;
+    columns = panels[ panel ].columns;
+}
+
+void HeadlessRenderer::clearPanel( int panel )
+{
+    Panel &target = panels[ panel ];
+    target.cells.assign( target.cells.size(), makeCell( " ", 1, STYLE_NORMAL ) );
+    target.cursorRow = 0;
+    target.cursorX = 0;
+}
+
+void HeadlessRenderer::blank( Panel &panel, int row, int x )
+{
+    panel.cells[ row * panel.columns + x ] = makeCell( " ", 1, STYLE_NORMAL );
+}
+
+void HeadlessRenderer::put( Panel &panel, int row, int x, std::string_view glyph, int width, unsigned int style )
+{
+    // overwriting either half of a wide character wipes out the other half
+    Cell *line = &panel.cells[ row * panel.columns ];
+    for ( int i = x; i < x + width; i++ ) {
+        if ( line[ i ].width == 0 && i > 0 ) {
+            blank( panel, row, i - 1 );
+        }
+        if ( line[ i ].width == 2 && i + 1 < panel.columns ) {
+            blank( panel, row, i + 1 );
+        }
+    }
+    line[ x ] = makeCell( glyph, width, style );
+    if ( width == 2 ) {
+        line[ x + 1 ] = makeCell( "", 0, style );
+    }
+}
+
+void HeadlessRenderer::drawBorder( int panel )
+{
+    Panel &target = panels[ panel ];
+    if ( target.rows < 2 || target.columns < 2 ) {
+        return;
+    }
+    int bottom = target.rows - 1;
+    int right = target.columns - 1;
+    for ( int x = 1; x < right; x++ ) {
+        put( target, 0, x, "─", 1, STYLE_NORMAL );
+        put( target, bottom, x, "─", 1, STYLE_NORMAL );
+    }
+    for ( int row = 1; row < bottom; row++ ) {
+        put( target, row, 0, "│", 1, STYLE_NORMAL );
+        put( target, row, right, "│", 1, STYLE_NORMAL );
+    }
+    put( target, 0, 0, "┌", 1, STYLE_NORMAL );
+    put( target, 0, right, "┐", 1, STYLE_NORMAL );
+    put( target, bottom, 0, "└", 1, STYLE_NORMAL );
+    put( target, bottom, right, "┘", 1, STYLE_NORMAL );
+}
+
+int HeadlessRenderer::print( int panel, int row, int x, std::string_view text, unsigned int style )
+{
+    Panel &target = panels[ panel ];
+    if ( row < 0 || row >= target.rows || x < 0 || x >= target.columns ) {
+        return x;
+    }
+    for ( size_t i = 0; i < text.length(); ) {
+        size_t end = Unicode::next( text, i );
+        std::string_view glyph = text.substr( i, end - i );
+        int width = Unicode::width( glyph );
+        if ( x + width > target.columns ) {
+            break;
+        }
+        // a mark with nothing to sit on takes no cell
+        if ( width > 0 ) {
+            put( target, row, x, glyph, width, style );
+            x += width;
+        }
+        i = end;
+    }
+    target.cursorRow = row;
+    target.cursorX = x < target.columns ? x : target.columns - 1;
+    return x;
+}
+
+void HeadlessRenderer::moveCursor( int panel, int row, int x )
+{
+    Panel &target = panels[ panel ];
+    if ( row >= 0 && row < target.rows && x >= 0 && x < target.columns ) {
+        target.cursorRow = row;
+        target.cursorX = x;
+    }
+}
+
+void HeadlessRenderer::refreshPanel( int panel )
+{
+    const Panel &source = panels[ panel ];
+    for ( int row = 0; row < source.rows; row++ ) {
+        int y = source.y + row;
+        if ( y < 0 || y >= rows ) {
+            continue;
+        }
+        for ( int x = 0; x < source.columns; x++ ) {
+            if ( source.x + x >= 0 && source.x + x < columns ) {
+                staged[ y * columns + source.x + x ] = source.cells[ row * source.columns + x ];
+            }
+        }
+    }
+    // the cursor is left where the last staged panel had it
+    cursorRow = source.y + source.cursorRow;
+    cursorX = source.x + source.cursorX;
+}
+
+unsigned long long HeadlessRenderer::hashCell( unsigned long long hash, const Cell &cell )
+{
+    // fnv-1a over the bytes, the style and the width
+    for ( unsigned char i = 0; i < cell.length; i++ ) {
+        hash = ( hash ^ (unsigned char)cell.bytes[ i ] ) * 0x100000001b3ULL;
+    }
+    return ( hash ^ ( cell.style << 8 | cell.width ) ) * 0x100000001b3ULL;
+}
+
+void HeadlessRenderer::hashRows( const std::vector< Cell > &screen, std::vector< unsigned long long > &hashes ) const
+{
+    hashes.resize( rows );
+    for ( int row = 0; row < rows; row++ ) {
+        unsigned long long hash = 0xcbf29ce484222325ULL;
+        for ( int x = 0; x < columns; x++ ) {
+            hash = hashCell( hash, screen[ row * columns + x ] );
+        }
+        hashes[ row ] = hash;
+    }
+}
+
+void HeadlessRenderer::scrollRows()
+{
+    // find the shift that lines up the most changed rows with rows that
+    // were already sent, it is worth a scroll region when that saves more
+    // rows than the region spoils
+    hashRows( staged, stagedHashes );
+    hashRows( sent, sentHashes );
+    Cell empty = makeCell( " ", 1, STYLE_NORMAL );
+    unsigned long long emptyHash = 0xcbf29ce484222325ULL;
+    for ( int x = 0; x < columns; x++ ) {
+        emptyHash = hashCell( emptyHash, empty );
+    }
+    int best = 0;
+    int bestGain = 0;
+    int top = 0;
+    int bottom = 0;
+    for ( int shift = 1 - rows; shift < rows; shift++ ) {
+        int first = rows;
+        int last = -1;
+        int matched = 0;
+        for ( int row = 0; row < rows; row++ ) {
+            int from = row + shift;
+            if ( shift != 0 && from >= 0 && from < rows && stagedHashes[ row ] != sentHashes[ row ] && stagedHashes[ row ] == sentHashes[ from ] ) {
+                matched++;
+                first = row < first ? row : first;
+                last = row;
+            }
+        }
+        if ( matched < 2 ) {
+            continue;
+        }
+        // the region covers where the rows come from and where they go,
+        // what scrolls in at its far end is blank
+        int regionTop = shift > 0 ? first : first + shift;
+        int regionBottom = shift > 0 ? last + shift : last;
+        int spoiled = 0;
+        for ( int row = regionTop; row <= regionBottom; row++ ) {
+            int from = row + shift;
+            unsigned long long after = from >= regionTop && from <= regionBottom ? sentHashes[ from ] : emptyHash;
+            if ( stagedHashes[ row ] == sentHashes[ row ] && stagedHashes[ row ] != after ) {
+                spoiled++;
+            }
+        }
+        if ( matched - spoiled > bestGain ) {
+            best = shift;
+            bestGain = matched - spoiled;
+            top = regionTop;
+            bottom = regionBottom;
+        }
+    }
+    if ( best == 0 ) {
+        return;
+    }
+
+    if ( best > 0 ) {
+        for ( int row = top; row <= bottom; row++ ) {
+            for ( int x = 0; x < columns; x++ ) {
+                sent[ row * columns + x ] = row + best <= bottom ? sent[ ( row + best ) * columns + x ] : empty;
+            }
+        }
+    } else {
+        for ( int row = bottom; row >= top; row-- ) {
+            for ( int x = 0; x < columns; x++ ) {
+                sent[ row * columns + x ] = row + best >= top ? sent[ ( row + best ) * columns + x ] : empty;
+            }
+        }
+    }
+    // ESC [ top ; bottom r is as long as a jump, then a jump to the edge,
+    // one LF or ESC M per row and ESC [ r to let go of the region again
+    int lines = best > 0 ? best : -best;
+    bytes += getMoveBytes( top, bottom ) + getMoveBytes( best > 0 ? bottom : top, 0 ) + lines * ( best > 0 ? 1 : 2 ) + 3;
+    if ( terminalStyle != STYLE_NORMAL ) {
+        bytes += getStyleBytes( STYLE_NORMAL );
+        terminalStyle = STYLE_NORMAL;
+    }
+    scrolledRows += lines;
+    // setting a region sends the cursor home
+    terminalRow = -1;
+    terminalX = -1;
+}
+
+void HeadlessRenderer::update()
+{
+    frames++;
+    scrollRows();
+    for ( int row = 0; row < rows; row++ ) {
+        for ( int x = 0; x < columns; x++ ) {
+            const Cell &cell = staged[ row * columns + x ];
+            Cell &shown = sent[ row * columns + x ];
+            if ( isSame( cell, shown ) == true ) {
+                continue;
+            }
+            shown = cell;
+            // the right half of a wide character goes out with its left half
+            if ( cell.width == 0 ) {
+                continue;
+            }
+            changedCells++;
+            if ( terminalRow != row || terminalX != x ) {
+                bytes += getMoveBytes( row, x );
+            }
+            if ( terminalStyle != cell.style ) {
+                bytes += getStyleBytes( cell.style );
+                terminalStyle = cell.style;
+            }
+            bytes += cell.length;
+            terminalRow = row;
+            terminalX = x + cell.width;
+        }
+    }
+    if ( terminalRow != cursorRow || terminalX != cursorX ) {
+        bytes += getMoveBytes( cursorRow, cursorX );
+        terminalRow = cursorRow;
+        terminalX = cursorX;
+    }
+}
+
+bool HeadlessRenderer::readInput( int panel, int timeout, int &c )
+{
+    if ( input.empty() == true ) {
+        c = INPUT_NONE;
+        return false;
+    }
+    c = input.front().first;
+    bool text = input.front().second;
+    input.pop_front();
+    return text;
+}
+
+void HeadlessRenderer::beep()
+{
+    beeps++;
+}
+
+void HeadlessRenderer::pushInput( int c, bool text )
+{
+    input.push_back( std::make_pair( c, text ) );
+}
+
+std::string HeadlessRenderer::getText( int row ) const
+{
+    // the row as it was last sent
+    std::string text;
+    for ( int x = 0; x < columns; x++ ) {
+        const Cell &cell = sent[ row * columns + x ];
+        text.append( cell.bytes, cell.length );
+    }
+    return text;
+}
+
+unsigned long long HeadlessRenderer::getFrames() const
+{
+    return frames;
+}
+
+unsigned long long HeadlessRenderer::getBytes() const
+{
+    return bytes;
+}
+
+unsigned long long HeadlessRenderer::getChangedCells() const
+{
+    return changedCells;
+}
+
+unsigned long long HeadlessRenderer::getScrolledRows() const
+{
+    return scrolledRows;
+}
+
+unsigned long long HeadlessRenderer::getBeeps() const
+{
+    return beeps;
+}
+
+/** END HEADLESSRENDERER **/
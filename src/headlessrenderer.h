@@ -0,0 +1,126 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#ifndef __HEADLESS_RENDERER__H_
+#define __HEADLESS_RENDERER__H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include "renderer.h"
+
+// room for a character and the combining marks on it
+#define CELL_BYTES 16
+
+/**
+    A renderer without a terminal. Panels and the screen are grids of
+    cells kept in memory, update() compares the staged screen with what
+    it sent last time and counts the bytes a terminal would have been
+    sent for the difference: a cursor jump to every run of changed cells,
+    a style change where the style differs, and the characters themselves.
+    Rows that only moved up or down are scrolled into place first, the
+    way curses does it, at the price of a scroll region. The count is
+    meant for comparing runs, curses itself spends more on style changes.
+
+    Input is whatever was queued with pushInput(), readInput() never waits.
+**/
+class HeadlessRenderer : public Renderer
+{
+public:
+    HeadlessRenderer( int rows, int columns );
+    ~HeadlessRenderer();
+
+    void getSize( int &rows, int &columns ) const;
+    int createPanel( int rows, int columns, int y, int x );
+    void destroyPanel( int panel );
+    void getPanelSize( int panel, int &rows, int &columns ) const;
+    void clearPanel( int panel );
+    void drawBorder( int panel );
+    int print( int panel, int row, int x, std::string_view text, unsigned int style );
+    void moveCursor( int panel, int row, int x );
+    void refreshPanel( int panel );
+    void update();
+    bool readInput( int panel, int timeout, int &c );
+    void beep();
+
+    void pushInput( int c, bool text );
+    std::string getText( int row ) const;
+    unsigned long long getFrames() const;
+    unsigned long long getBytes() const;
+    unsigned long long getChangedCells() const;
+    unsigned long long getScrolledRows() const;
+    unsigned long long getBeeps() const;
+
+private:
+    struct Cell
+    {
+        // the right half of a wide character has no bytes of its own
+        char bytes[ CELL_BYTES ];
+        unsigned char length;
+        unsigned char width;
+        unsigned int style;
+    };
+
+    struct Panel
+    {
+        int rows;
+        int columns;
+        int y;
+        int x;
+        int cursorRow;
+        int cursorX;
+        bool used;
+        std::vector< Cell > cells;
+    };
+
+    void scrollRows();
+    void hashRows( const std::vector< Cell > &screen, std::vector< unsigned long long > &hashes ) const;
+    static unsigned long long hashCell( unsigned long long hash, const Cell &cell );
+    void put( Panel &panel, int row, int x, std::string_view glyph, int width, unsigned int style );
+    void blank( Panel &panel, int row, int x );
+    static Cell makeCell( std::string_view glyph, int width, unsigned int style );
+    static bool isSame( const Cell &a, const Cell &b );
+    static size_t getMoveBytes( int row, int x );
+    static size_t getStyleBytes( unsigned int style );
+
+    int rows;
+    int columns;
+    std::vector< Panel > panels;
+    std::vector< Cell > staged;
+    std::vector< Cell > sent;
+    std::vector< unsigned long long > stagedHashes;
+    std::vector< unsigned long long > sentHashes;
+    std::deque< std::pair< int, bool > > input;
+    int cursorRow;
+    int cursorX;
+    int terminalRow;
+    int terminalX;
+    unsigned int terminalStyle;
+    unsigned long long frames;
+    unsigned long long bytes;
+    unsigned long long changedCells;
+    unsigned long long scrolledRows;
+    unsigned long long beeps;
+};
+
+#endif
@@ -0,0 +1,377 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "importer.h"
+#include "sshdatabase.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <string.h>
+#include <thread>
+
+// below this a single thread is faster than starting workers
+#define PARALLEL_THRESHOLD ( 1 << 20 )
+
+static std::string trim( const std::string &s )
+{
+    size_t start = s.find_first_not_of( " \t\r" );
+    if ( start == std::string::npos ) {
+        return "";
+    }
+    size_t end = s.find_last_not_of( " \t\r" );
+    return s.substr( start, end - start + 1 );
+}
+
+/** BEGIN IMPORTER **/
+
+Importer::Importer( ImportFormat format, std::string group )
+    :   format( format ),
+        group( group ),
+        skipped( 0 )
+{
+    const char *user = getenv( "USER" );
+    defaultUser = user != NULL ? user : "";
+}
+
+Importer::~Importer()
+{
+    for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
+        delete (*it);
+    }
+    connections.clear();
+}
+
+std::vector< Connection* > Importer::takeConnections()
+{
+    std::vector< Connection* > retval;
+    retval.swap( connections );
+    return retval;
+}
+
+unsigned int Importer::getSkipped() const
+{
+    return skipped;
+}
+
+ImportFormat Importer::parseFormat( std::string name )
+{
+    if ( name == "ssh_config" || name == "config" ) {
+        return IMPORT_SSH_CONFIG;
+    } else if ( name == "known_hosts" ) {
+        return IMPORT_KNOWN_HOSTS;
+    } else if ( name == "csv" ) {
+        return IMPORT_CSV;
+    } else if ( name == "tsv" ) {
+        return IMPORT_TSV;
+    }
+    return IMPORT_AUTO;
+}
+
+ImportFormat Importer::detectFormat( std::string path, const char *data, size_t length )
+{
+    std::string base = path.substr( path.rfind( '/' ) == std::string::npos ? 0 : path.rfind( '/' ) + 1 );
+    if ( base.compare( 0, 11, "known_hosts" ) == 0 ) {
+        return IMPORT_KNOWN_HOSTS;
+    }
+    if ( base == "config" || base == "ssh_config" ) {
+        return IMPORT_SSH_CONFIG;
+    }
+    if ( base.length() > 4 && base.compare( base.length() - 4, 4, ".csv" ) == 0 ) {
+        return IMPORT_CSV;
+    }
+    if ( base.length() > 4 && base.compare( base.length() - 4, 4, ".tsv" ) == 0 ) {
+        return IMPORT_TSV;
+    }
+
+    // sniff the first line that says anything
+    size_t pos = 0;
+    while ( pos < length ) {
+        size_t end = pos;
+        while ( end < length && data[ end ] != '\n' ) {
+            end++;
+        }
+        std::string line = trim( std::string( data + pos, end - pos ) );
+        pos = end + 1;
+        if ( line.empty() == true || line[ 0 ] == '#' ) {
+            continue;
+        }
+        if ( strncasecmp( line.c_str(), "host ", 5 ) == 0 || strncasecmp( line.c_str(), "host=", 5 ) == 0 ) {
+            return IMPORT_SSH_CONFIG;
+        }
+        if ( line.find( '\t' ) != std::string::npos ) {
+            return IMPORT_TSV;
+        }
+        if ( line.find( ',' ) != std::string::npos && line.find( ' ' ) == std::string::npos ) {
+            return IMPORT_CSV;
+        }
+        return IMPORT_KNOWN_HOSTS;
+    }
+    return IMPORT_CSV;
+}
+
+bool Importer::parseFile( std::string path )
+{
+    int fd = open( path.c_str(), O_RDONLY );
+    if ( fd < 0 ) {
+        return false;
+    }
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 ) {
+        close( fd );
+        return false;
+    }
+    if ( st.st_size == 0 ) {
+        close( fd );
+        return true;
+    }
+    void *mapped = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( mapped == MAP_FAILED ) {
+        return false;
+    }
+    madvise( mapped, st.st_size, MADV_SEQUENTIAL );
+
+    const char *data = (const char*)mapped;
+    ImportFormat fileFormat = format == IMPORT_AUTO ? detectFormat( path, data, st.st_size ) : format;
+    if ( fileFormat == IMPORT_SSH_CONFIG ) {
+        // Host blocks span lines, this one is read front to back
+        parseSSHConfig( data, st.st_size );
+    } else {
+        parseLines( data, st.st_size, fileFormat );
+    }
+    munmap( mapped, st.st_size );
+    return true;
+}
+
+void Importer::parseSSHConfig( const char *data, size_t length )
+{
+    std::vector< Connection* > block;
+    size_t pos = 0;
+    while ( pos <= length ) {
+        size_t end = pos;
+        while ( end < length && data[ end ] != '\n' ) {
+            end++;
+        }
+        std::string line = trim( std::string( data + pos, end - pos ) );
+        pos = end + 1;
+        if ( line.empty() == true || line[ 0 ] == '#' ) {
+            continue;
+        }
+
+        // "Keyword value", "Keyword=value" and "Keyword = value" are all valid
+        size_t split = line.find_first_of( " \t=" );
+        std::string keyword = line.substr( 0, split );
+        std::string value = split == std::string::npos ? "" : trim( line.substr( split ) );
+        if ( value.empty() == false && value[ 0 ] == '=' ) {
+            value = trim( value.substr( 1 ) );
+        }
+        // the same rule as provider output, a stray 0x1f would split the record
+        value = Connection::sanitize( value );
+
+        if ( strcasecmp( keyword.c_str(), "Host" ) == 0 || strcasecmp( keyword.c_str(), "Match" ) == 0 ) {
+            connections.insert( connections.end(), block.begin(), block.end() );
+            block.clear();
+            if ( strcasecmp( keyword.c_str(), "Match" ) == 0 ) {
+                continue;
+            }
+            size_t start = 0;
+            while ( start < value.length() ) {
+                size_t stop = value.find_first_of( " \t", start );
+                if ( stop == std::string::npos ) {
+                    stop = value.length();
+                }
+                std::string alias = value.substr( start, stop - start );
+                start = value.find_first_not_of( " \t", stop );
+                if ( start == std::string::npos ) {
+                    start = value.length();
+                }
+                // wildcard and negated patterns are defaults, not hosts
+                if ( alias.empty() == true || alias.find_first_of( "*?!" ) != std::string::npos ) {
+                    continue;
+                }
+                block.push_back( new Connection( alias, alias, group, defaultUser, "" ) );
+            }
+        } else if ( strcasecmp( keyword.c_str(), "HostName" ) == 0 ) {
+            for ( std::vector< Connection* >::iterator it = block.begin(); it != block.end(); ++it ) {
+                (*it)->setHostname( value );
+            }
+        } else if ( strcasecmp( keyword.c_str(), "User" ) == 0 ) {
+            for ( std::vector< Connection* >::iterator it = block.begin(); it != block.end(); ++it ) {
+                (*it)->setUser( value );
+            }
+        }
+    }
+    connections.insert( connections.end(), block.begin(), block.end() );
+}
+
+void Importer::parseLines( const char *data, size_t length, ImportFormat lineFormat )
+{
+    unsigned int workers = std::thread::hardware_concurrency();
+    if ( workers == 0 || length < PARALLEL_THRESHOLD ) {
+        workers = 1;
+    }
+
+    // cut the mapping into one chunk per worker, always on a line break
+    std::vector< Chunk > chunks( workers );
+    const char *begin = data;
+    const char *end = data + length;
+    for ( unsigned int i = 0; i < workers; i++ ) {
+        const char *stop = i + 1 == workers ? end : data + length / workers * ( i + 1 );
+        if ( stop < begin ) {
+            stop = begin;
+        }
+        while ( stop < end && *stop != '\n' ) {
+            stop++;
+        }
+        chunks[ i ].begin = begin;
+        chunks[ i ].end = stop;
+        chunks[ i ].skipped = 0;
+        begin = stop < end ? stop + 1 : end;
+    }
+
+    std::vector< std::thread > threads;
+    for ( unsigned int i = 1; i < workers; i++ ) {
+        threads.push_back( std::thread( &Importer::parseChunk, this, &chunks[ i ], lineFormat ) );
+    }
+    parseChunk( &chunks[ 0 ], lineFormat );
+    for ( std::vector< std::thread >::iterator it = threads.begin(); it != threads.end(); ++it ) {
+        it->join();
+    }
+
+    // stitch the results back together in file order
+    for ( std::vector< Chunk >::iterator it = chunks.begin(); it != chunks.end(); ++it ) {
+        connections.insert( connections.end(), it->connections.begin(), it->connections.end() );
+        skipped += it->skipped;
+    }
+}
+
+void Importer::parseChunk( Chunk *chunk, ImportFormat lineFormat )
+{
+    const char *pos = chunk->begin;
+    std::string line;
+    while ( pos < chunk->end ) {
+        const char *stop = (const char*)memchr( pos, '\n', chunk->end - pos );
+        if ( stop == NULL ) {
+            stop = chunk->end;
+        }
+        line.assign( pos, stop - pos );
+        pos = stop + 1;
+        if ( line.empty() == false && line[ line.length() - 1 ] == '\r' ) {
+            line.erase( line.length() - 1 );
+        }
+        if ( line.empty() == true || line[ 0 ] == '#' ) {
+            continue;
+        }
+
+        // a header row names its columns
+        char separator = lineFormat == IMPORT_TSV ? '\t' : ',';
+        if ( lineFormat != IMPORT_KNOWN_HOSTS && strncasecmp( line.c_str(), "name", 4 ) == 0 && line.length() > 4 && line[ 4 ] == separator ) {
+            continue;
+        }
+
+        Connection *connection = NULL;
+        if ( lineFormat == IMPORT_KNOWN_HOSTS ) {
+            connection = parseKnownHost( line, chunk->skipped );
+        } else {
+            connection = parseDelimited( line, separator );
+            if ( connection == NULL ) {
+                chunk->skipped++;
+            }
+        }
+        if ( connection != NULL ) {
+            chunk->connections.push_back( connection );
+        }
+    }
+}
+
+Connection* Importer::parseKnownHost( const std::string &line, unsigned int &skipped )
+{
+    std::string hosts = line.substr( 0, line.find_first_of( " \t" ) );
+    if ( hosts.empty() == true ) {
+        return NULL;
+    }
+    // @cert-authority and @revoked lines do not describe a single host
+    if ( hosts[ 0 ] == '@' ) {
+        skipped++;
+        return NULL;
+    }
+    // hashed entries (|1|salt|hash) cannot be turned back into a name
+    if ( hosts[ 0 ] == '|' ) {
+        skipped++;
+        return NULL;
+    }
+    std::string host = hosts.substr( 0, hosts.find( ',' ) );
+    if ( host.empty() == false && host[ 0 ] == '[' ) {
+        // [host]:port, a connection has no port, so only the default one
+        // can be imported without pointing it at the wrong sshd
+        size_t close = host.find( ']' );
+        if ( close == std::string::npos || ( close + 1 < host.length() && host.compare( close + 1, std::string::npos, ":22" ) != 0 ) ) {
+            skipped++;
+            return NULL;
+        }
+        host = host.substr( 1, close - 1 );
+    }
+    if ( host.empty() == true || host.find_first_of( "*?!" ) != std::string::npos ) {
+        skipped++;
+        return NULL;
+    }
+    host = Connection::sanitize( host );
+    return new Connection( host, host, group, defaultUser, "" );
+}
+
+Connection* Importer::parseDelimited( const std::string &line, char separator )
+{
+    // name, hostname, group, user and an optional password, CSV fields may be quoted
+    std::vector< std::string > fields;
+    std::string field;
+    bool quoted = false;
+    for ( size_t i = 0; i < line.length(); i++ ) {
+        char c = line[ i ];
+        if ( separator == ',' && c == '"' ) {
+            if ( quoted == true && i + 1 < line.length() && line[ i + 1 ] == '"' ) {
+                field += '"';
+                i++;
+            } else {
+                quoted = !quoted;
+            }
+        } else if ( c == separator && quoted == false ) {
+            fields.push_back( trim( Connection::sanitize( field ) ) );
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    fields.push_back( trim( Connection::sanitize( field ) ) );
+
+    if ( fields.size() < 2 || fields[ 0 ].empty() == true || fields[ 1 ].empty() == true ) {
+        return NULL;
+    }
+    fields.resize( 5 );
+    return new Connection( fields[ 0 ], fields[ 1 ],
+                           fields[ 2 ].empty() ? group : fields[ 2 ],
+                           fields[ 3 ].empty() ? defaultUser : fields[ 3 ],
+                           fields[ 4 ] );
+}
+
+/** END IMPORTER **/
@@ -0,0 +1,83 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __IMPORTER__H_
+#define __IMPORTER__H_
+
+#include <string>
+#include <vector>
+
+class Connection;
+
+enum ImportFormat
+{
+    IMPORT_AUTO,
+    IMPORT_SSH_CONFIG,
+    IMPORT_KNOWN_HOSTS,
+    IMPORT_CSV,
+    IMPORT_TSV
+};
+
+/**
+    Reads ~/.ssh/config Host blocks, known_hosts and CSV/TSV inventories
+    (name,hostname,group,user[,password]) into unsaved connections. This
+    is not streaming: the whole file is mapped into memory, line based
+    formats are split into chunks that are parsed in parallel, and every
+    connection is held until the end. Fields get the same control
+    character rules as provider output. Hand the result to
+    SSHDatabase::addConnections to commit it with a single write.
+**/
+class Importer
+{
+public:
+    Importer( ImportFormat format, std::string group );
+    ~Importer();
+
+    bool parseFile( std::string path );
+    std::vector< Connection* > takeConnections();
+    unsigned int getSkipped() const;
+
+    static ImportFormat detectFormat( std::string path, const char *data, size_t length );
+    static ImportFormat parseFormat( std::string name );
+
+private:
+    struct Chunk
+    {
+        const char *begin;
+        const char *end;
+        std::vector< Connection* > connections;
+        unsigned int skipped;
+    };
+
+    void parseSSHConfig( const char *data, size_t length );
+    void parseLines( const char *data, size_t length, ImportFormat lineFormat );
+    void parseChunk( Chunk *chunk, ImportFormat lineFormat );
+    Connection* parseKnownHost( const std::string &line, unsigned int &skipped );
+    Connection* parseDelimited( const std::string &line, char separator );
+
+    ImportFormat format;
+    std::string group;
+    std::string defaultUser;
+    std::vector< Connection* > connections;
+    unsigned int skipped;
+};
+
+#endif
@@ -0,0 +1,334 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#include "latency.h"
+#include "sshdatabase.h"
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+// launches remembered per connection, the percentiles come from these
+#define HISTORY_SAMPLES 50
+// how often to look for ssh having exited while a master holds its stderr
+#define EXIT_POLL_MS 200
+
+/** BEGIN LATENCYHISTORY **/
+
+std::string LatencyHistory::getHistoryPath()
+{
+    const char *home_path = getenv( "HOME" );
+    return std::string( home_path != NULL ? home_path : "" ) + "/.scc/latency";
+}
+
+void LatencyHistory::load()
+{
+    samples.clear();
+    std::ifstream ifs( getHistoryPath().c_str() );
+    std::string line;
+    while ( std::getline( ifs, line ) ) {
+        std::istringstream iss( line );
+        std::string name;
+        std::string flag;
+        std::string prompt;
+        LatencySample sample;
+        if ( std::getline( iss, name, '\t' ) && ( iss >> sample.when >> sample.teardown >> sample.spawn >> sample.connect >> sample.auth >> sample.total >> flag ) ) {
+            // older lines have no prompt column
+            iss >> prompt;
+            sample.multiplexed = flag == "m";
+            sample.prompted = prompt == "p";
+            samples[ name ].push_back( sample );
+        }
+    }
+    summarize();
+}
+
+bool LatencyHistory::record( const std::string &name, const LatencySample &sample )
+{
+    // another scc may have recorded in the meantime, start from the file
+    load();
+    samples[ name ].push_back( sample );
+    summarize();
+    return save();
+}
+
+bool LatencyHistory::save() const
+{
+    std::stringstream temp;
+    temp << getHistoryPath() << "." << getpid();
+    std::ofstream ofs( temp.str().c_str() );
+    if ( ofs.is_open() == false ) {
+        return false;
+    }
+    for ( std::map< std::string, std::vector< LatencySample > >::const_iterator it = samples.begin(); it != samples.end(); ++it ) {
+        for ( std::vector< LatencySample >::const_iterator sample = it->second.begin(); sample != it->second.end(); ++sample ) {
+            ofs << it->first << '\t' << sample->when << '\t' << sample->teardown << '\t' << sample->spawn << '\t'
+                << sample->connect << '\t' << sample->auth << '\t' << sample->total << '\t' << ( sample->multiplexed == true ? "m" : "-" ) << '\t'
+                << ( sample->prompted == true ? "p" : "-" ) << '\n';
+        }
+    }
+    ofs.close();
+    return ofs.fail() == false && rename( temp.str().c_str(), getHistoryPath().c_str() ) == 0;
+}
+
+void LatencyHistory::summarize()
+{
+    summaries.clear();
+    std::vector< unsigned int > totals;
+    for ( std::map< std::string, std::vector< LatencySample > >::iterator it = samples.begin(); it != samples.end(); ++it ) {
+        // only the most recent launches count, the file never grows past them
+        if ( it->second.size() > HISTORY_SAMPLES ) {
+            it->second.erase( it->second.begin(), it->second.end() - HISTORY_SAMPLES );
+        }
+        LatencySummary &summary = summaries[ it->first ];
+        summary.prompted = 0;
+        totals.clear();
+        for ( std::vector< LatencySample >::iterator sample = it->second.begin(); sample != it->second.end(); ++sample ) {
+            if ( sample->prompted == true ) {
+                summary.prompted++;
+                continue;
+            }
+            totals.push_back( sample->total );
+            summary.last = *sample;
+        }
+        summary.runs = totals.size();
+        if ( totals.empty() == true ) {
+            summary.p50 = summary.p95 = 0;
+            summary.last = it->second.back();
+            continue;
+        }
+        std::sort( totals.begin(), totals.end() );
+        // nearest rank, the p95 of a handful of launches is their slowest
+        summary.p50 = totals[ ( totals.size() * 50 + 99 ) / 100 - 1 ];
+        summary.p95 = totals[ ( totals.size() * 95 + 99 ) / 100 - 1 ];
+    }
+}
+
+const LatencySummary* LatencyHistory::find( const std::string &name ) const
+{
+    std::map< std::string, LatencySummary >::const_iterator it = summaries.find( name );
+    return it != summaries.end() ? &it->second : NULL;
+}
+
+/** END LATENCYHISTORY **/
+
+
+/** BEGIN SHELLTIMER **/
+
+ShellTimer::ShellTimer( const std::string &name, unsigned long long pressed, bool passwordSupplied )
+    :   name( name ),
+        pressed( pressed ),
+        started( 0 ),
+        connecting( 0 ),
+        connected( 0 ),
+        authenticated( 0 ),
+        passwordSupplied( passwordSupplied ),
+        showLog( Connection::isSshVerbose() ),
+        multiplexed( false ),
+        prompted( false ),
+        done( false )
+{
+}
+
+unsigned long long ShellTimer::getMilliseconds()
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (unsigned long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+bool ShellTimer::isEnabled()
+{
+    return getenv( "SCC_NO_TIMING" ) == NULL;
+}
+
+int ShellTimer::run( const std::string &command )
+{
+    int fds[ 2 ];
+    if ( isEnabled() == false || pipe( fds ) != 0 ) {
+        return system( command.c_str() );
+    }
+
+    // like system(), ^C and ^\ are for ssh while it runs
+    struct sigaction ignore, oldInt, oldQuit;
+    memset( &ignore, 0, sizeof( ignore ) );
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset( &ignore.sa_mask );
+    sigaction( SIGINT, &ignore, &oldInt );
+    sigaction( SIGQUIT, &ignore, &oldQuit );
+
+    started = getMilliseconds();
+    pid_t pid = fork();
+    if ( pid == 0 ) {
+        signal( SIGINT, SIG_DFL );
+        signal( SIGQUIT, SIG_DFL );
+        close( fds[ 0 ] );
+        dup2( fds[ 1 ], 2 );
+        close( fds[ 1 ] );
+        execl( "/bin/sh", "sh", "-c", command.c_str(), (char*)NULL );
+        _exit( 127 );
+    }
+    close( fds[ 1 ] );
+
+    int status = -1;
+    bool exited = pid < 0;
+    char buffer[ 4096 ];
+    // a ControlPersist master started by ssh keeps the pipe open after ssh
+    // is gone, so stop once ssh has exited and the pipe has run dry
+    while ( pid > 0 ) {
+        struct pollfd pfd;
+        pfd.fd = fds[ 0 ];
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready = poll( &pfd, 1, exited == true ? 0 : EXIT_POLL_MS );
+        if ( ready > 0 ) {
+            ssize_t length = read( fds[ 0 ], buffer, sizeof( buffer ) );
+            if ( length > 0 ) {
+                unsigned long long at = getMilliseconds();
+                pending.append( buffer, length );
+                size_t start = 0;
+                for ( size_t end = pending.find( '\n' ); end != std::string::npos; end = pending.find( '\n', start ) ) {
+                    // ssh ends its lines with \r\n while the terminal is raw
+                    size_t text = end > start && pending[ end - 1 ] == '\r' ? end - 1 : end;
+                    if ( parseLine( pending.substr( start, text - start ), at ) == false ) {
+                        forward( pending.data() + start, end + 1 - start );
+                    }
+                    start = end + 1;
+                }
+                pending.erase( 0, start );
+                // a prompt without a newline must not wait for one, only
+                // hold on to what could still become a debug line
+                size_t prefix = pending.length() < 5 ? pending.length() : 5;
+                if ( pending.compare( 0, prefix, "debug", prefix ) != 0 ) {
+                    forward( pending.data(), pending.length() );
+                    pending.clear();
+                }
+                continue;
+            }
+            if ( length < 0 && errno == EINTR ) {
+                continue;
+            }
+            break;
+        }
+        if ( ready < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( exited == true ) {
+            break;
+        }
+        exited = waitpid( pid, &status, WNOHANG ) == pid;
+    }
+    close( fds[ 0 ] );
+    while ( exited == false && waitpid( pid, &status, 0 ) < 0 ) {
+        exited = errno != EINTR;
+    }
+    if ( pending.empty() == false && parseLine( pending, getMilliseconds() ) == false ) {
+        forward( pending.data(), pending.length() );
+    }
+
+    sigaction( SIGINT, &oldInt, NULL );
+    sigaction( SIGQUIT, &oldQuit, NULL );
+    return status;
+}
+
+void ShellTimer::forward( const char *data, size_t length )
+{
+    while ( length > 0 ) {
+        ssize_t written = write( 2, data, length );
+        if ( written < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( written <= 0 ) {
+            return;
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+bool ShellTimer::parseLine( const std::string &line, unsigned long long at )
+{
+    // true for ssh's own log, which stays out of the terminal unless the
+    // user's own -v asked for it
+    if ( line.compare( 0, 5, "debug" ) == 0 ) {
+        if ( connecting == 0 && line.find( ": Connecting to " ) != std::string::npos ) {
+            connecting = at;
+        } else if ( connected == 0 && line.find( ": Connection established." ) != std::string::npos ) {
+            connected = at;
+        } else if ( line.find( "master session id: " ) != std::string::npos ) {
+            multiplexed = true;
+            finish( at );
+        } else if ( line.find( ": Entering interactive session." ) != std::string::npos ) {
+            finish( at );
+        } else if ( passwordSupplied == false && ( line.find( ": Next authentication method: password" ) != std::string::npos
+                || line.find( ": Next authentication method: keyboard-interactive" ) != std::string::npos ) ) {
+            prompted = true;
+        }
+        return showLog == false;
+    }
+    // the host key question itself goes to the tty, what ssh logs around
+    // it does not, a key added without asking is flagged all the same
+    if ( line.compare( 0, 25, "The authenticity of host " ) == 0 || line.compare( 0, 27, "Warning: Permanently added " ) == 0 ) {
+        prompted = true;
+        return false;
+    }
+    if ( line.compare( 0, 17, "Authenticated to " ) == 0 ) {
+        authenticated = authenticated == 0 ? at : authenticated;
+        return showLog == false;
+    }
+    return showLog == false && ( line.compare( 0, 8, "OpenSSH_" ) == 0
+        || line.compare( 0, 13, "Transferred: " ) == 0
+        || line.compare( 0, 18, "Bytes per second: " ) == 0 );
+}
+
+void ShellTimer::finish( unsigned long long at )
+{
+    // recorded as soon as the shell is there, the session may last all day
+    if ( done == true ) {
+        return;
+    }
+    done = true;
+    // a phase ssh skipped, like connecting through a master, takes no time
+    unsigned long long connectStart = connecting != 0 ? connecting : ( connected != 0 ? connected : at );
+    unsigned long long connectEnd = connected != 0 ? connected : connectStart;
+    unsigned long long authEnd = authenticated != 0 ? authenticated : at;
+    LatencySample sample;
+    sample.when = time( NULL );
+    sample.teardown = started - pressed;
+    sample.spawn = connectStart - started;
+    sample.connect = connectEnd - connectStart;
+    sample.auth = authEnd > connectEnd ? authEnd - connectEnd : 0;
+    sample.total = at - pressed;
+    sample.multiplexed = multiplexed;
+    sample.prompted = prompted;
+    LatencyHistory history;
+    history.record( name, sample );
+}
+
+/** END SHELLTIMER **/
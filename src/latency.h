@@ -0,0 +1,134 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#ifndef __LATENCY__H_
+#define __LATENCY__H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <time.h>
+#include <sys/types.h>
+
+// one launch, every phase in milliseconds
+struct LatencySample
+{
+    time_t when;
+    unsigned int teardown;
+    unsigned int spawn;
+    unsigned int connect;
+    unsigned int auth;
+    unsigned int total;
+    // an existing ControlMaster took the session, nothing to connect
+    bool multiplexed;
+    // ssh waited on a person, for a password or to accept a host key
+    bool prompted;
+};
+
+struct LatencySummary
+{
+    // runs and the percentiles leave out the prompted launches
+    unsigned int runs;
+    unsigned int prompted;
+    unsigned int p50;
+    unsigned int p95;
+    LatencySample last;
+};
+
+/**
+    How long each connection took from Enter to a usable remote shell,
+    kept in ~/.scc/latency as one tab separated line per launch:
+
+        <name> <when> <teardown> <spawn> <connect> <auth> <total> <m|-> <p|->
+
+    Only the most recent launches of every connection are kept, the
+    percentiles are taken over the totals of those. A launch that sat at
+    a prompt timed the person answering it and is kept out of them.
+**/
+class LatencyHistory
+{
+public:
+    void load();
+    bool record( const std::string &name, const LatencySample &sample );
+    const LatencySummary* find( const std::string &name ) const;
+
+    static std::string getHistoryPath();
+
+private:
+    bool save() const;
+    void summarize();
+
+    std::map< std::string, std::vector< LatencySample > > samples;
+    std::map< std::string, LatencySummary > summaries;
+};
+
+/**
+    Runs an ssh command line with -v and times the launch from its log.
+    ssh writes every log line in one go, each is stamped as it arrives:
+
+        teardown  Enter until scc is out of the way and ssh is started
+        spawn     until ssh starts connecting, config and proxies included
+        connect   until the TCP connection is established
+        auth      until ssh is authenticated, key exchange included
+
+    The total runs from Enter until the session is entered. A launch that
+    never gets that far is not recorded. One that asks for a password or
+    for a new host key to be accepted is recorded as prompted, unless the
+    password is handed to ssh by sshpass. Everything ssh writes to stderr
+    besides its own debug log is passed on.
+
+    The ssh binary can be overridden with $SCC_SSH, which is also how a
+    stand-in is tested. When that command carries a -v of its own, the
+    log is timed and still shown. Timing is off while $SCC_NO_TIMING is
+    set, the command then runs as it is and nothing is recorded.
+**/
+class ShellTimer
+{
+public:
+    ShellTimer( const std::string &name, unsigned long long pressed, bool passwordSupplied = false );
+
+    int run( const std::string &command );
+
+    static unsigned long long getMilliseconds();
+    static bool isEnabled();
+
+private:
+    bool parseLine( const std::string &line, unsigned long long at );
+    void forward( const char *data, size_t length );
+    void finish( unsigned long long at );
+
+    std::string name;
+    unsigned long long pressed;
+    unsigned long long started;
+    unsigned long long connecting;
+    unsigned long long connected;
+    unsigned long long authenticated;
+    bool passwordSupplied;
+    // the user asked ssh for its log, it is passed on rather than swallowed
+    bool showLog;
+    bool multiplexed;
+    bool prompted;
+    bool done;
+    std::string pending;
+};
+
+#endif
@@ -0,0 +1,170 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "launcher.h"
+#include "sshdatabase.h"
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sstream>
+
+// tiled panes get unreadable past this, the rest go into another window
+#define MAX_PANES_PER_WINDOW 16
+
+/** BEGIN LAUNCHER **/
+
+Launcher::Launcher( LaunchLayout layout )
+    :   layout( layout )
+{
+}
+
+const std::string& Launcher::getStatus() const
+{
+    return status;
+}
+
+std::string Launcher::getTmuxPath()
+{
+    const char *tmux = getenv( "SCC_TMUX" );
+    return tmux != NULL && tmux[ 0 ] != '\0' ? tmux : "tmux";
+}
+
+std::string Launcher::escapeArgument( const std::string &argument )
+{
+    // tmux reads an argument ending in ; as the end of a command, \; keeps
+    // it literal, the commands themselves are already quoted for the shell
+    if ( argument.empty() == false && argument[ argument.length() - 1 ] == ';' ) {
+        return argument.substr( 0, argument.length() - 1 ) + "\\;";
+    }
+    return argument;
+}
+
+std::vector< std::string > Launcher::buildArguments( const std::vector< Connection* > &targets, const std::string &session ) const
+{
+    std::vector< std::string > arguments;
+    arguments.push_back( getTmuxPath() );
+    unsigned int panes = 0;
+    for ( std::vector< Connection* >::const_iterator it = targets.begin(); it != targets.end(); ++it ) {
+        if ( it != targets.begin() ) {
+            arguments.push_back( ";" );
+        }
+        if ( layout != LAUNCH_WINDOWS && panes > 0 && panes < MAX_PANES_PER_WINDOW ) {
+            arguments.push_back( "split-window" );
+            arguments.push_back( escapeArgument( (*it)->getCommand() ) );
+            arguments.push_back( ";" );
+            // re-tile after every split or tmux runs out of room for the next one
+            arguments.push_back( "select-layout" );
+            arguments.push_back( "tiled" );
+            panes++;
+        } else {
+            if ( layout == LAUNCH_SYNCHRONIZED && panes > 1 ) {
+                arguments.push_back( "set-window-option" );
+                arguments.push_back( "synchronize-panes" );
+                arguments.push_back( "on" );
+                arguments.push_back( ";" );
+            }
+            if ( it == targets.begin() && session.empty() == false ) {
+                arguments.push_back( "new-session" );
+                arguments.push_back( "-d" );
+                arguments.push_back( "-s" );
+                arguments.push_back( session );
+            } else {
+                arguments.push_back( "new-window" );
+            }
+            arguments.push_back( "-n" );
+            arguments.push_back( layout == LAUNCH_WINDOWS ? escapeArgument( (*it)->getName() ) : "scc" );
+            arguments.push_back( escapeArgument( (*it)->getCommand() ) );
+            panes = 1;
+        }
+    }
+    if ( layout == LAUNCH_SYNCHRONIZED && panes > 1 ) {
+        arguments.push_back( ";" );
+        arguments.push_back( "set-window-option" );
+        arguments.push_back( "synchronize-panes" );
+        arguments.push_back( "on" );
+    }
+    return arguments;
+}
+
+bool Launcher::run( const std::vector< std::string > &arguments ) const
+{
+    std::vector< char* > argv;
+    for ( std::vector< std::string >::const_iterator it = arguments.begin(); it != arguments.end(); ++it ) {
+        argv.push_back( const_cast< char* >( it->c_str() ) );
+    }
+    argv.push_back( NULL );
+
+    pid_t pid = fork();
+    if ( pid == 0 ) {
+        // keep tmux from scribbling over the curses screen
+        int null = open( "/dev/null", O_RDWR );
+        dup2( null, 0 );
+        dup2( null, 1 );
+        dup2( null, 2 );
+        execvp( argv[ 0 ], &argv[ 0 ] );
+        _exit( 127 );
+    }
+    if ( pid < 0 ) {
+        return false;
+    }
+    int status = 0;
+    while ( waitpid( pid, &status, 0 ) < 0 ) {
+        if ( errno != EINTR ) {
+            return false;
+        }
+    }
+    return WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+}
+
+bool Launcher::launch( const std::vector< Connection* > &targets )
+{
+    if ( targets.empty() == true ) {
+        status = "nothing to launch";
+        return false;
+    }
+
+    // outside tmux there is no current session to add windows to
+    std::string session;
+    if ( getenv( "TMUX" ) == NULL ) {
+        std::stringstream ss;
+        ss << "scc-" << getpid() << "-" << time( NULL );
+        session = ss.str();
+    }
+
+    std::stringstream ss;
+    if ( run( buildArguments( targets, session ) ) == false ) {
+        ss << "unable to launch " << getTmuxPath();
+        status = ss.str();
+        return false;
+    }
+    ss << "launched " << targets.size();
+    if ( session.empty() == false ) {
+        ss << ", tmux attach -t " << session;
+    }
+    status = ss.str();
+    return true;
+}
+
+/** END LAUNCHER **/
@@ -0,0 +1,64 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __LAUNCHER__H_
+#define __LAUNCHER__H_
+
+#include <string>
+#include <vector>
+
+class Connection;
+
+enum LaunchLayout
+{
+    LAUNCH_WINDOWS,
+    LAUNCH_PANES,
+    LAUNCH_SYNCHRONIZED
+};
+
+/**
+    Opens a set of connections in tmux without leaving scc. Everything is
+    sent as one chained tmux command, so the sessions start side by side
+    instead of one after the other. Inside tmux they land in the current
+    session, outside of it a new detached session is created.
+
+    The tmux binary can be overridden with $SCC_TMUX.
+**/
+class Launcher
+{
+public:
+    Launcher( LaunchLayout layout );
+
+    bool launch( const std::vector< Connection* > &targets );
+    const std::string& getStatus() const;
+
+    static std::string getTmuxPath();
+
+private:
+    static std::string escapeArgument( const std::string &argument );
+    std::vector< std::string > buildArguments( const std::vector< Connection* > &targets, const std::string &session ) const;
+    bool run( const std::vector< std::string > &arguments ) const;
+
+    LaunchLayout layout;
+    std::string status;
+};
+
+#endif
@@ -0,0 +1,119 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "layer.h"
+#include "sshdatabase.h"
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+/** BEGIN LAYER **/
+
+Layer::Layer( std::string name, std::string path, bool readOnly )
+    :   name( name ),
+        path( path ),
+        readOnly( readOnly )
+{
+}
+
+const std::string& Layer::getName() const
+{
+    return name;
+}
+
+const std::string& Layer::getPath() const
+{
+    return path;
+}
+
+bool Layer::isReadOnly() const
+{
+    return readOnly;
+}
+
+unsigned long long Layer::getSize() const
+{
+    struct stat st;
+    if ( stat( path.c_str(), &st ) != 0 ) {
+        return 0;
+    }
+    return st.st_size;
+}
+
+std::string Layer::getSourcesPath()
+{
+    const char *home_path = getenv( "HOME" );
+    return std::string( home_path != NULL ? home_path : "" ) + "/.scc/sources";
+}
+
+std::string Layer::expandPath( std::string path )
+{
+    if ( path.compare( 0, 2, "~/" ) == 0 ) {
+        const char *home_path = getenv( "HOME" );
+        return std::string( home_path != NULL ? home_path : "" ) + path.substr( 1 );
+    }
+    return path;
+}
+
+std::vector< Layer > Layer::loadSources()
+{
+    std::vector< Layer > layers;
+    std::ifstream ifs( getSourcesPath().c_str() );
+    std::string line;
+    while ( std::getline( ifs, line ) ) {
+        std::istringstream iss( line );
+        std::string mode;
+        std::string path;
+        if ( !( iss >> mode ) || mode[ 0 ] == '#' ) {
+            continue;
+        }
+        std::getline( iss >> std::ws, path );
+        if ( path.empty() == true || ( mode != "ro" && mode != "rw" ) ) {
+            continue;
+        }
+        path = expandPath( path );
+        layers.push_back( Layer( path, path, mode == "ro" ) );
+    }
+
+    // only the topmost rw layer takes writes
+    bool writable = false;
+    for ( std::vector< Layer >::reverse_iterator it = layers.rbegin(); it != layers.rend(); ++it ) {
+        if ( it->readOnly == false ) {
+            if ( writable == true ) {
+                it->readOnly = true;
+            }
+            writable = true;
+        }
+    }
+    if ( writable == false ) {
+        layers.push_back( Layer( "", SSHDatabase::getDatabasePath(), false ) );
+    }
+    for ( std::vector< Layer >::iterator it = layers.begin(); it != layers.end(); ++it ) {
+        if ( it->readOnly == false ) {
+            // local connections carry an empty source
+            it->name.clear();
+        }
+    }
+    return layers;
+}
+
+/** END LAYER **/
@@ -0,0 +1,59 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __LAYER__H_
+#define __LAYER__H_
+
+#include <string>
+#include <vector>
+
+/**
+    One connection source in ~/.scc/sources, listed lowest priority first:
+
+        ro /srv/team/scc/connections
+        rw ~/.scc/connections
+        ro ~/.scc/overrides
+
+    When two layers hold the same name the later one wins. The topmost rw
+    layer receives every write, any other layer is treated as read-only.
+    Without a sources file there is a single rw ~/.scc/connections.
+**/
+class Layer
+{
+public:
+    Layer( std::string name, std::string path, bool readOnly );
+
+    const std::string& getName() const;
+    const std::string& getPath() const;
+    bool isReadOnly() const;
+    unsigned long long getSize() const;
+
+    static std::vector< Layer > loadSources();
+    static std::string getSourcesPath();
+    static std::string expandPath( std::string path );
+
+private:
+    std::string name;
+    std::string path;
+    bool readOnly;
+};
+
+#endif
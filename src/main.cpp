@@ -24,32 +24,273 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <stdlib.h>
+#include <locale.h>
+#include <time.h>
 #include <sstream>
 #include <iostream>
 #include "resources.h"
+#include "daemon.h"
+#include "importer.h"
+#include "completion.h"
+#include "headlessrenderer.h"
+#include "latency.h"
+
+// a shell has no use for more candidates than this on one TAB
+#define MAX_COMPLETIONS 1000
+
+// the screen --bench-draw draws on and how many frames each phase runs
+#define BENCH_ROWS 50
+#define BENCH_COLUMNS 160
+#define BENCH_FRAMES 200
 
 void handle_signal( int signal )
 {
     if ( signal == SIGINT ) {
         // Check if we should run an SSH connection at exit
         std::string exec;
+        std::string name;
+        bool passwordSupplied = false;
+        unsigned long long pressed = Resources::Instance()->getSSHDatabase()->getRunOnExitTime();
         if ( Resources::Instance()->getSSHDatabase()->getRunOnExit() != NULL ) {
-            exec = Resources::Instance()->getSSHDatabase()->getRunOnExit()->getCommand();
+            exec = Resources::Instance()->getSSHDatabase()->getRunOnExit()->getCommand( ShellTimer::isEnabled() );
+            name = Resources::Instance()->getSSHDatabase()->getRunOnExit()->getName();
+            passwordSupplied = Resources::Instance()->getSSHDatabase()->getRunOnExit()->getPassword().empty() == false;
         }
         Resources::Instance()->DestroyInstance();
-        system(exec.c_str());
+        if ( exec.empty() == false ) {
+            ShellTimer timer( name, pressed, passwordSupplied );
+            timer.run( exec );
+        }
         exit(0);
     }
 }
 
+void printUsage()
+{
+    std::cout << "usage: scc [options]" << std::endl
+              << "  connect <name>           connect to the named connection right away" << std::endl
+              << "  --daemon [--foreground]  keep the connection database resident behind " << DaemonClient::getSocketPath() << std::endl
+              << "  --list [--regex|--glob] [search]" << std::endl
+              << "                           print matching connections and exit" << std::endl
+              << "  --import <file> [--format ssh_config|known_hosts|csv|tsv] [--group <group>]" << std::endl
+              << "                           add connections from an ssh config, known_hosts or CSV/TSV file" << std::endl
+              << "  --completion-script bash|zsh|fish" << std::endl
+              << "                           print a shell completion script, e.g. source <(scc --completion-script bash)" << std::endl
+              << "  --complete name|group [prefix]" << std::endl
+              << "                           print completions from the cache, used by the completion scripts" << std::endl
+              << "  --bench-draw [frames]    draw the connection list without a terminal and report" << std::endl
+              << "                           the time and terminal output per frame" << std::endl
+              << "  --help                   show this help" << std::endl;
+}
+
+int listConnections( std::string searchText, SearchMode mode )
+{
+    // prefer the resident daemon, fall back to parsing the database ourselves
+    std::vector< Connection* > result;
+    ConnectionTable version;
+    bool fromDaemon = DaemonClient::fetch( DAEMON_OP_QUERY, std::string( 1, (char)mode ) + searchText, result );
+    if ( fromDaemon == false ) {
+        Resources::Instance()->getSSHDatabase()->waitForUncachedProviders();
+        result = Resources::Instance()->getSSHDatabase()->search( searchText, mode, &version );
+    }
+    for ( std::vector< Connection* >::iterator it = result.begin(); it != result.end(); ++it ) {
+        std::cout << (*it)->getName() << "\t" << (*it)->getHostname() << "\t" << (*it)->getGroup() << "\t" << (*it)->getUser() << std::endl;
+        if ( fromDaemon == true ) {
+            delete (*it);
+        }
+    }
+    return 0;
+}
+
+int connectTo( const std::string &name )
+{
+    // a resident daemon can answer by name, anything the query language
+    // would read as more than a plain name goes to our own database
+    std::string command;
+    std::string found;
+    bool passwordSupplied = false;
+    std::vector< Connection* > result;
+    bool plain = name.empty() == false && name[ 0 ] != '-' && name.find_first_of( " \t\"()*?" ) == std::string::npos;
+    if ( plain == true && DaemonClient::fetch( DAEMON_OP_QUERY, std::string( 1, (char)SEARCH_TEXT ) + "name:" + name, result ) == true ) {
+        // the query ignores case, prefer the exact spelling if there is one
+        for ( std::vector< Connection* >::iterator it = result.begin(); it != result.end(); ++it ) {
+            if ( (*it)->getName() == name || ( command.empty() == true && result.size() == 1 ) ) {
+                command = (*it)->getCommand( ShellTimer::isEnabled() );
+                found = (*it)->getName();
+                passwordSupplied = (*it)->getPassword().empty() == false;
+            }
+            delete (*it);
+        }
+    } else {
+        SSHDatabase *database = Resources::Instance()->getSSHDatabase();
+        database->waitForLoad();
+        database->waitForUncachedProviders();
+        Connection *connection = database->getConnectionByName( name );
+        if ( connection != NULL ) {
+            command = connection->getCommand( ShellTimer::isEnabled() );
+            found = connection->getName();
+            passwordSupplied = connection->getPassword().empty() == false;
+        }
+    }
+    if ( command.empty() == true ) {
+        std::cerr << "scc: no connection named " << name << std::endl;
+        return 1;
+    }
+    // timed from here, there is no Enter to start from
+    ShellTimer timer( found, ShellTimer::getMilliseconds(), passwordSupplied );
+    Resources::Instance()->DestroyInstance();
+    int status = timer.run( command );
+    return WIFEXITED( status ) ? WEXITSTATUS( status ) : 1;
+}
+
+int completeWord( const std::string &kind, const std::string &prefix )
+{
+    // answered from the cache alone, the database is only loaded when there
+    // is no cache yet
+    CompletionCache cache;
+    if ( cache.open() == false ) {
+        Resources::Instance()->getSSHDatabase()->waitForLoad();
+        CompletionCache::write( Resources::Instance()->getSSHDatabase()->getSnapshot() );
+        if ( cache.open() == false ) {
+            return 1;
+        }
+    }
+    std::vector< std::string_view > words = cache.complete( kind == "group" ? COMPLETE_GROUP : COMPLETE_NAME, prefix, MAX_COMPLETIONS );
+    for ( std::vector< std::string_view >::iterator it = words.begin(); it != words.end(); ++it ) {
+        std::cout << (*it) << '\n';
+    }
+    return 0;
+}
+
+void benchPhase( const char *phase, Window &window, HeadlessRenderer &renderer, const int *keys, size_t count, unsigned int frames )
+{
+    // the keys are fed one per frame over and over, each shows on the
+    // frame after it, printable ascii goes in as typed text
+    unsigned long long bytes = renderer.getBytes();
+    unsigned long long cells = renderer.getChangedCells();
+    unsigned long long scrolled = renderer.getScrolledRows();
+    struct timespec start, end;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    size_t key = 0;
+    for ( unsigned int i = 0; i < frames; i++ ) {
+        if ( count > 0 ) {
+            renderer.pushInput( keys[ key ], keys[ key ] >= ' ' && keys[ key ] < K_BACKSPACE );
+            key = ( key + 1 ) % count;
+        }
+        window.drawFrame();
+    }
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    double ms = ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_nsec - start.tv_nsec ) / 1000000.0;
+    printf( "%-12s %8u %10.3f %12.1f %12.1f %12.2f\n", phase, frames, ms / frames,
+            (double)( renderer.getBytes() - bytes ) / frames, (double)( renderer.getChangedCells() - cells ) / frames,
+            (double)( renderer.getScrolledRows() - scrolled ) / frames );
+}
+
+int benchDraw( unsigned int frames )
+{
+    // the window draws into memory, what a terminal would have been sent
+    // is counted instead of written
+    SSHDatabase *database = Resources::Instance()->getSSHDatabase();
+    database->waitForLoad();
+    database->waitForUncachedProviders();
+    HeadlessRenderer *renderer = new HeadlessRenderer( BENCH_ROWS, BENCH_COLUMNS );
+    Window window( renderer );
+    window.init();
+
+    static const int scrollDown[] = { K_DOWN };
+    static const int scrollUp[] = { K_UP };
+    static const int search[] = { 'a', K_BACKSPACE };
+    printf( "%u connections on %ux%u\n", (unsigned int)database->getSnapshot().size(), BENCH_ROWS, BENCH_COLUMNS );
+    printf( "%-12s %8s %10s %12s %12s %12s\n", "phase", "frames", "ms/frame", "bytes/frame", "cells/frame", "rows/frame" );
+    benchPhase( "first", window, *renderer, NULL, 0, 1 );
+    benchPhase( "idle", window, *renderer, NULL, 0, frames );
+    benchPhase( "scroll down", window, *renderer, scrollDown, 1, frames );
+    benchPhase( "scroll up", window, *renderer, scrollUp, 1, frames );
+    benchPhase( "search", window, *renderer, search, 2, frames );
+    return 0;
+}
+
+int importConnections( int argc, char *argv[] )
+{
+    std::string path;
+    std::string group;
+    ImportFormat format = IMPORT_AUTO;
+    for ( int i = 2; i < argc; i++ ) {
+        std::string arg = argv[ i ];
+        if ( arg == "--format" && i + 1 < argc ) {
+            format = Importer::parseFormat( argv[ ++i ] );
+        } else if ( arg == "--group" && i + 1 < argc ) {
+            group = argv[ ++i ];
+        } else {
+            path = arg;
+        }
+    }
+    if ( path.empty() == true ) {
+        printUsage();
+        return 1;
+    }
+
+    Importer importer( format, group );
+    if ( importer.parseFile( path ) == false ) {
+        std::cerr << "scc: unable to read " << path << std::endl;
+        return 1;
+    }
+    std::vector< Connection* > batch = importer.takeConnections();
+    size_t parsed = batch.size();
+    unsigned int added = Resources::Instance()->getSSHDatabase()->addConnections( batch );
+    std::cout << "imported " << added << " of " << parsed << " connections ("
+              << parsed - added << " already known, "
+              << importer.getSkipped() << " lines skipped)" << std::endl;
+    return 0;
+}
+
 int main( int argc, char *argv[] )
 {
+    // ncursesw only reads and draws UTF-8 once the locale says so
+    setlocale( LC_ALL, "" );
+
     // make sure we have a ~/.ch/ structure
-    char *home_path = getenv( "HOME" );
-    char data_path[256];
-    sprintf(data_path,"%s/.scc",home_path);
-    mkdir( data_path, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH );
+    const char *home_path = getenv( "HOME" );
+    std::string data_path = std::string( home_path != NULL ? home_path : "" ) + "/.scc";
+    mkdir( data_path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH );
+
+    if ( argc > 1 ) {
+        std::string command = argv[ 1 ];
+        if ( command == "--daemon" ) {
+            bool foreground = argc > 2 && std::string( argv[ 2 ] ) == "--foreground";
+            DatabaseDaemon daemon;
+            return daemon.run( foreground == false );
+        } else if ( command == "--import" ) {
+            return importConnections( argc, argv );
+        } else if ( command == "--list" ) {
+            SearchMode mode = SEARCH_TEXT;
+            int arg = 2;
+            if ( argc > arg && std::string( argv[ arg ] ) == "--regex" ) {
+                mode = SEARCH_REGEX;
+                arg++;
+            } else if ( argc > arg && std::string( argv[ arg ] ) == "--glob" ) {
+                mode = SEARCH_GLOB;
+                arg++;
+            }
+            return listConnections( argc > arg ? argv[ arg ] : "", mode );
+        } else if ( command == "connect" && argc > 2 ) {
+            return connectTo( argv[ 2 ] );
+        } else if ( command == "--complete" && argc > 2 ) {
+            return completeWord( argv[ 2 ], argc > 3 ? argv[ 3 ] : "" );
+        } else if ( command == "--bench-draw" ) {
+            int frames = argc > 2 ? atoi( argv[ 2 ] ) : BENCH_FRAMES;
+            return benchDraw( frames > 0 ? frames : BENCH_FRAMES );
+        } else if ( command == "--completion-script" && argc > 2 && CompletionCache::getScript( argv[ 2 ] ) != NULL ) {
+            std::cout << CompletionCache::getScript( argv[ 2 ] );
+            return 0;
+        } else {
+            printUsage();
+            return command == "--help" ? 0 : 1;
+        }
+    }
+
     // register our signal handler
     signal( SIGINT, handle_signal );
 
@@ -59,4 +300,3 @@ int main( int argc, char *argv[] )
         Resources::Instance()->getWindow()->draw();
     }
 }
-
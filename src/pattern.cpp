@@ -0,0 +1,566 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "pattern.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <algorithm>
+#include <deque>
+
+// keep pathological patterns like (a|b){200} from eating the machine
+#define MAX_NFA_STATES 8192
+#define MAX_DFA_STATES 4096
+// nfa states visited while building the dfa, past either limit the nfa is simulated instead
+#define MAX_DFA_WORK ( 1 << 24 )
+#define DEAD_STATE -1
+
+struct Pattern::Node
+{
+    enum Type { NODE_SET, NODE_CONCAT, NODE_ALTERNATE, NODE_REPEAT };
+
+    Node( Type type ) : type( type ), min( 0 ), max( 0 ) {}
+    ~Node()
+    {
+        for ( std::vector< Node* >::iterator it = children.begin(); it != children.end(); ++it ) {
+            delete (*it);
+        }
+    }
+
+    Type type;
+    std::bitset< 256 > chars;
+    std::vector< Node* > children;
+    int min;
+    int max;
+};
+
+static void addCaseFolded( std::bitset< 256 > &chars, unsigned char c )
+{
+    chars.set( c );
+    chars.set( toupper( c ) );
+    chars.set( tolower( c ) );
+}
+
+/** BEGIN PATTERN **/
+
+Pattern::Pattern( std::string source, SearchMode mode )
+    :   source( mode == SEARCH_GLOB ? globToRegex( source ) : source ),
+        position( 0 ),
+        valid( true ),
+        anchoredStart( false ),
+        anchoredEnd( false ),
+        simulated( false ),
+        nfaStart( 0 )
+{
+    compile();
+}
+
+Pattern::~Pattern()
+{
+}
+
+bool Pattern::isValid() const
+{
+    return valid;
+}
+
+std::string Pattern::globToRegex( std::string glob )
+{
+    std::string regex = "^";
+    bool inClass = false;
+    for ( size_t i = 0; i < glob.length(); i++ ) {
+        char c = glob[ i ];
+        if ( inClass == true ) {
+            if ( c == ']' ) {
+                inClass = false;
+            }
+            regex += c;
+        } else if ( c == '*' ) {
+            regex += ".*";
+        } else if ( c == '?' ) {
+            regex += ".";
+        } else if ( c == '[' ) {
+            inClass = true;
+            regex += c;
+            if ( i + 1 < glob.length() && glob[ i + 1 ] == '!' ) {
+                regex += '^';
+                i++;
+            }
+        } else if ( isalnum( (unsigned char)c ) == 0 ) {
+            regex += '\\';
+            regex += c;
+        } else {
+            regex += c;
+        }
+    }
+    return regex + "$";
+}
+
+bool Pattern::parseEscape( char c, std::bitset< 256 > &chars )
+{
+    bool negate = isupper( (unsigned char)c ) != 0;
+    std::bitset< 256 > set;
+    switch ( tolower( (unsigned char)c ) ) {
+    case 'd':
+        for ( int i = '0'; i <= '9'; i++ ) set.set( i );
+        break;
+    case 'w':
+        for ( int i = 0; i < 256; i++ ) {
+            if ( isalnum( i ) || i == '_' ) set.set( i );
+        }
+        break;
+    case 's':
+        for ( int i = 0; i < 256; i++ ) {
+            if ( isspace( i ) ) set.set( i );
+        }
+        break;
+    default:
+        // any other escaped character stands for itself
+        addCaseFolded( chars, c );
+        return true;
+    }
+    chars |= negate ? ~set : set;
+    return true;
+}
+
+bool Pattern::parseClass( std::bitset< 256 > &chars )
+{
+    // position is just past '['
+    bool negate = false;
+    std::bitset< 256 > set;
+    if ( position < source.length() && source[ position ] == '^' ) {
+        negate = true;
+        position++;
+    }
+    bool first = true;
+    while ( position < source.length() && ( source[ position ] != ']' || first == true ) ) {
+        first = false;
+        unsigned char c = source[ position++ ];
+        if ( c == '\\' && position < source.length() ) {
+            parseEscape( source[ position++ ], set );
+            continue;
+        }
+        if ( position + 1 < source.length() && source[ position ] == '-' && source[ position + 1 ] != ']' ) {
+            unsigned char last = source[ position + 1 ];
+            position += 2;
+            if ( last < c ) {
+                return false;
+            }
+            for ( int i = c; i <= last; i++ ) {
+                addCaseFolded( set, i );
+            }
+            continue;
+        }
+        addCaseFolded( set, c );
+    }
+    if ( position >= source.length() ) {
+        return false;
+    }
+    position++;
+    chars |= negate ? ~set : set;
+    return true;
+}
+
+Pattern::Node* Pattern::parseAtom()
+{
+    char c = source[ position++ ];
+    Node *node = NULL;
+    switch ( c ) {
+    case '(':
+        node = parseAlternation();
+        if ( position >= source.length() || source[ position ] != ')' ) {
+            valid = false;
+        } else {
+            position++;
+        }
+        return node;
+    case '.':
+        node = new Node( Node::NODE_SET );
+        node->chars.set();
+        return node;
+    case '[':
+        node = new Node( Node::NODE_SET );
+        if ( parseClass( node->chars ) == false ) {
+            valid = false;
+        }
+        return node;
+    case '\\':
+        node = new Node( Node::NODE_SET );
+        if ( position >= source.length() ) {
+            valid = false;
+        } else {
+            parseEscape( source[ position++ ], node->chars );
+        }
+        return node;
+    case '*':
+    case '+':
+    case '?':
+    case '{':
+    case '^':
+    case '$':
+        // nothing to repeat, or an anchor away from the ends
+        valid = false;
+        return new Node( Node::NODE_CONCAT );
+    default:
+        node = new Node( Node::NODE_SET );
+        addCaseFolded( node->chars, c );
+        return node;
+    }
+}
+
+Pattern::Node* Pattern::parseRepetition()
+{
+    Node *atom = parseAtom();
+    while ( valid == true && position < source.length() ) {
+        int min, max;
+        char c = source[ position ];
+        if ( c == '*' ) {
+            min = 0;
+            max = -1;
+        } else if ( c == '+' ) {
+            min = 1;
+            max = -1;
+        } else if ( c == '?' ) {
+            min = 0;
+            max = 1;
+        } else if ( c == '{' ) {
+            size_t close = source.find( '}', position );
+            if ( close == std::string::npos ) {
+                valid = false;
+                break;
+            }
+            std::string range = source.substr( position + 1, close - position - 1 );
+            size_t comma = range.find( ',' );
+            min = atoi( range.c_str() );
+            if ( comma == std::string::npos ) {
+                max = min;
+            } else {
+                max = comma + 1 < range.length() ? atoi( range.c_str() + comma + 1 ) : -1;
+            }
+            if ( range.empty() == true || isdigit( (unsigned char)range[ 0 ] ) == 0 || ( max != -1 && max < min ) || min > 255 || max > 255 ) {
+                valid = false;
+                break;
+            }
+            position = close;
+        } else {
+            break;
+        }
+        position++;
+        Node *repeat = new Node( Node::NODE_REPEAT );
+        repeat->children.push_back( atom );
+        repeat->min = min;
+        repeat->max = max;
+        atom = repeat;
+    }
+    return atom;
+}
+
+Pattern::Node* Pattern::parseConcatenation()
+{
+    Node *node = new Node( Node::NODE_CONCAT );
+    while ( valid == true && position < source.length() && source[ position ] != '|' && source[ position ] != ')' ) {
+        node->children.push_back( parseRepetition() );
+    }
+    return node;
+}
+
+Pattern::Node* Pattern::parseAlternation()
+{
+    Node *node = new Node( Node::NODE_ALTERNATE );
+    node->children.push_back( parseConcatenation() );
+    while ( valid == true && position < source.length() && source[ position ] == '|' ) {
+        position++;
+        node->children.push_back( parseConcatenation() );
+    }
+    return node;
+}
+
+int Pattern::addState( NfaState::Type type, int out1, int out2 )
+{
+    if ( nfa.size() >= MAX_NFA_STATES ) {
+        valid = false;
+    }
+    NfaState state;
+    state.type = type;
+    state.out1 = out1;
+    state.out2 = out2;
+    nfa.push_back( state );
+    return nfa.size() - 1;
+}
+
+int Pattern::build( const Node *node, int next )
+{
+    // built back to front, every fragment is handed the state it continues to
+    if ( valid == false ) {
+        return next;
+    }
+    switch ( node->type ) {
+    case Node::NODE_SET: {
+        int state = addState( NfaState::STATE_CHAR, next, -1 );
+        nfa[ state ].chars = node->chars;
+        return state;
+    }
+    case Node::NODE_CONCAT:
+        for ( std::vector< Node* >::const_reverse_iterator it = node->children.rbegin(); it != node->children.rend(); ++it ) {
+            next = build( *it, next );
+        }
+        return next;
+    case Node::NODE_ALTERNATE: {
+        int start = build( node->children.back(), next );
+        for ( std::vector< Node* >::const_reverse_iterator it = node->children.rbegin() + 1; it != node->children.rend(); ++it ) {
+            int branch = build( *it, next );
+            start = addState( NfaState::STATE_SPLIT, branch, start );
+        }
+        return start;
+    }
+    case Node::NODE_REPEAT: {
+        const Node *child = node->children.front();
+        int start = next;
+        if ( node->max == -1 ) {
+            int loop = addState( NfaState::STATE_SPLIT, -1, next );
+            int body = build( child, loop );
+            nfa[ loop ].out1 = body;
+            start = loop;
+        } else {
+            for ( int i = node->min; i < node->max; i++ ) {
+                start = addState( NfaState::STATE_SPLIT, build( child, start ), next );
+            }
+        }
+        for ( int i = 0; i < node->min; i++ ) {
+            start = build( child, start );
+        }
+        return start;
+    }
+    }
+    return next;
+}
+
+void Pattern::closure( int state, std::vector< unsigned int > &seen, unsigned int stamp, std::vector< int > &out ) const
+{
+    // seen is shared by every closure of one step, stamping it saves clearing it
+    if ( state < 0 || seen[ state ] == stamp ) {
+        return;
+    }
+    seen[ state ] = stamp;
+    if ( nfa[ state ].type == NfaState::STATE_SPLIT ) {
+        closure( nfa[ state ].out1, seen, stamp, out );
+        closure( nfa[ state ].out2, seen, stamp, out );
+    } else {
+        out.push_back( state );
+    }
+}
+
+void Pattern::compile()
+{
+    if ( source.empty() == false && source[ 0 ] == '^' ) {
+        anchoredStart = true;
+        position = 1;
+    }
+    // a $ is only an anchor when the backslashes before it pair up
+    size_t escapes = 0;
+    while ( escapes + 1 < source.length() && source[ source.length() - 2 - escapes ] == '\\' ) {
+        escapes++;
+    }
+    std::string body = source;
+    if ( source.length() > position && source[ source.length() - 1 ] == '$' && escapes % 2 == 0 ) {
+        anchoredEnd = true;
+        source.erase( source.length() - 1 );
+    }
+
+    Node *root = parseAlternation();
+    if ( position != source.length() ) {
+        valid = false;
+    }
+    int match = addState( NfaState::STATE_MATCH, -1, -1 );
+    nfaStart = build( root, match );
+    delete root;
+    source = body;
+    if ( valid == false ) {
+        return;
+    }
+
+    // subset construction, an unanchored pattern restarts at every byte
+    std::vector< int > startSet;
+    std::vector< unsigned int > seen( nfa.size(), 0 );
+    unsigned int stamp = 1;
+    closure( nfaStart, seen, stamp, startSet );
+    std::sort( startSet.begin(), startSet.end() );
+
+    std::map< std::vector< int >, int > states;
+    // a deque, so the set being expanded stays put while new ones are added
+    std::deque< std::vector< int > > pending;
+    std::vector< int > target;
+    size_t work = 0;
+    states[ startSet ] = 0;
+    pending.push_back( startSet );
+    for ( size_t current = 0; current < pending.size(); current++ ) {
+        const std::vector< int > &set = pending[ current ];
+        bool accept = false;
+        for ( std::vector< int >::const_iterator it = set.begin(); it != set.end(); ++it ) {
+            if ( nfa[ *it ].type == NfaState::STATE_MATCH ) {
+                accept = true;
+            }
+        }
+        accepting.push_back( accept );
+        transitions.resize( ( current + 1 ) * 256, DEAD_STATE );
+
+        for ( int c = 0; c < 256; c++ ) {
+            target.clear();
+            stamp++;
+            for ( std::vector< int >::const_iterator it = set.begin(); it != set.end(); ++it ) {
+                if ( nfa[ *it ].type == NfaState::STATE_CHAR && nfa[ *it ].chars.test( c ) ) {
+                    closure( nfa[ *it ].out1, seen, stamp, target );
+                }
+            }
+            if ( anchoredStart == false ) {
+                closure( nfaStart, seen, stamp, target );
+            }
+            work += set.size() + target.size();
+            if ( target.empty() == true ) {
+                continue;
+            }
+            std::sort( target.begin(), target.end() );
+            std::map< std::vector< int >, int >::iterator found = states.find( target );
+            if ( found == states.end() ) {
+                if ( pending.size() >= MAX_DFA_STATES || work > MAX_DFA_WORK ) {
+                    // still correct, only slower per byte
+                    simulated = true;
+                    transitions.clear();
+                    accepting.clear();
+                    return;
+                }
+                found = states.insert( std::make_pair( target, (int)pending.size() ) ).first;
+                pending.push_back( target );
+            }
+            transitions[ current * 256 + c ] = found->second;
+        }
+    }
+    nfa.clear();
+}
+
+bool Pattern::simulate( const char *data, size_t length ) const
+{
+    // the same steps the dfa takes, one set of nfa states at a time, the
+    // buffers belong to the thread so a search still allocates nothing
+    static thread_local std::vector< unsigned int > seen;
+    static thread_local unsigned int stamp = 0;
+    static thread_local std::vector< int > current;
+    static thread_local std::vector< int > next;
+    if ( seen.size() < nfa.size() || stamp > UINT_MAX - length - 2 ) {
+        seen.assign( std::max( seen.size(), nfa.size() ), 0 );
+        stamp = 0;
+    }
+    current.clear();
+    closure( nfaStart, seen, ++stamp, current );
+    for ( size_t i = 0; i <= length; i++ ) {
+        bool accept = false;
+        for ( std::vector< int >::iterator it = current.begin(); it != current.end(); ++it ) {
+            if ( nfa[ *it ].type == NfaState::STATE_MATCH ) {
+                accept = true;
+            }
+        }
+        if ( i == length || ( anchoredEnd == false && accept == true ) ) {
+            return accept;
+        }
+        next.clear();
+        stamp++;
+        for ( std::vector< int >::iterator it = current.begin(); it != current.end(); ++it ) {
+            if ( nfa[ *it ].type == NfaState::STATE_CHAR && nfa[ *it ].chars.test( (unsigned char)data[ i ] ) ) {
+                closure( nfa[ *it ].out1, seen, stamp, next );
+            }
+        }
+        if ( anchoredStart == false ) {
+            closure( nfaStart, seen, stamp, next );
+        }
+        if ( next.empty() == true ) {
+            return false;
+        }
+        current.swap( next );
+    }
+    return false;
+}
+
+bool Pattern::matches( const char *data, size_t length ) const
+{
+    if ( valid == false ) {
+        return false;
+    }
+    if ( simulated == true ) {
+        return simulate( data, length );
+    }
+    int state = 0;
+    for ( size_t i = 0; i < length; i++ ) {
+        if ( anchoredEnd == false && accepting[ state ] == true ) {
+            return true;
+        }
+        state = transitions[ state * 256 + (unsigned char)data[ i ] ];
+        if ( state == DEAD_STATE ) {
+            return false;
+        }
+    }
+    return accepting[ state ];
+}
+
+bool Pattern::matches( const std::string &field ) const
+{
+    return matches( field.data(), field.length() );
+}
+
+/** END PATTERN **/
+
+
+/** BEGIN PATTERNCACHE **/
+
+PatternCache::PatternCache( size_t capacity )
+    :   capacity( capacity )
+{
+}
+
+PatternCache::~PatternCache()
+{
+}
+
+std::shared_ptr< const Pattern > PatternCache::get( std::string_view source, SearchMode mode )
+{
+    // every redraw asks for the pattern in use, answer that without building a key
+    if ( entries.empty() == false && entries.front().first.first == mode && entries.front().first.second == source ) {
+        return entries.front().second;
+    }
+    Key key( mode, std::string( source ) );
+    std::map< Key, Entries::iterator >::iterator found = index.find( key );
+    if ( found != index.end() ) {
+        // move to the front, most recently used
+        entries.splice( entries.begin(), entries, found->second );
+        return found->second->second;
+    }
+
+    // an evicted pattern lives on until the last search using it is done
+    std::shared_ptr< const Pattern > pattern( new Pattern( key.second, mode ) );
+    entries.push_front( std::make_pair( key, pattern ) );
+    index[ key ] = entries.begin();
+    if ( entries.size() > capacity ) {
+        index.erase( entries.back().first );
+        entries.pop_back();
+    }
+    return pattern;
+}
+
+/** END PATTERNCACHE **/
@@ -0,0 +1,121 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __PATTERN__H_
+#define __PATTERN__H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <bitset>
+
+enum SearchMode
+{
+    SEARCH_TEXT,
+    SEARCH_REGEX,
+    SEARCH_GLOB
+};
+
+/**
+    A regex or glob compiled to a case insensitive DFA with one 256 entry
+    transition row per state, so matching is a single table walk over the
+    bytes of a field.
+
+    Regex supports literals, ., [] classes, \d \w \s (and negations),
+    grouping, |, *, +, ? and {m,n}, with ^ and $ anchors at the ends of the
+    pattern. A regex matches anywhere in a field, a glob (* ? [...]) has to
+    match the whole field.
+
+    Patterns whose DFA would outgrow its state or work budget, e.g.
+    (a|b)*a(a|b){12}, keep the NFA instead and match by simulating it.
+**/
+class Pattern
+{
+public:
+    Pattern( std::string source, SearchMode mode );
+    ~Pattern();
+
+    bool isValid() const;
+    bool matches( const char *data, size_t length ) const;
+    bool matches( const std::string &field ) const;
+
+    static std::string globToRegex( std::string glob );
+
+private:
+    struct Node;
+    struct NfaState
+    {
+        enum Type { STATE_CHAR, STATE_SPLIT, STATE_MATCH };
+        Type type;
+        std::bitset< 256 > chars;
+        int out1;
+        int out2;
+    };
+
+    Node* parseAlternation();
+    Node* parseConcatenation();
+    Node* parseRepetition();
+    Node* parseAtom();
+    bool parseClass( std::bitset< 256 > &chars );
+    bool parseEscape( char c, std::bitset< 256 > &chars );
+    int addState( NfaState::Type type, int out1, int out2 );
+    int build( const Node *node, int next );
+    void closure( int state, std::vector< unsigned int > &seen, unsigned int stamp, std::vector< int > &out ) const;
+    void compile();
+    bool simulate( const char *data, size_t length ) const;
+
+    std::string source;
+    size_t position;
+    bool valid;
+    bool anchoredStart;
+    bool anchoredEnd;
+    bool simulated;
+    std::vector< NfaState > nfa;
+    int nfaStart;
+    std::vector< int > transitions;
+    std::vector< bool > accepting;
+};
+
+/**
+    Small LRU of compiled patterns, so editing a pattern back and forth in
+    the search box does not rebuild the same automaton on every keystroke.
+**/
+class PatternCache
+{
+public:
+    PatternCache( size_t capacity = 16 );
+    ~PatternCache();
+
+    std::shared_ptr< const Pattern > get( std::string_view source, SearchMode mode );
+
+private:
+    typedef std::pair< SearchMode, std::string > Key;
+    typedef std::list< std::pair< Key, std::shared_ptr< const Pattern > > > Entries;
+
+    size_t capacity;
+    Entries entries;
+    std::map< Key, Entries::iterator > index;
+};
+
+#endif
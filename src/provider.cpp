@@ -0,0 +1,433 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "provider.h"
+#include "sshdatabase.h"
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+
+// seconds between two runs of a command, whatever its ttl says
+#define MIN_REFRESH_INTERVAL 5
+
+/** BEGIN record parsing **/
+
+static void appendUtf8( std::string &out, unsigned int cp )
+{
+    if ( cp < 0x80 ) {
+        out += char( cp );
+    } else if ( cp < 0x800 ) {
+        out += char( 0xc0 | ( cp >> 6 ) );
+        out += char( 0x80 | ( cp & 0x3f ) );
+    } else if ( cp < 0x10000 ) {
+        out += char( 0xe0 | ( cp >> 12 ) );
+        out += char( 0x80 | ( ( cp >> 6 ) & 0x3f ) );
+        out += char( 0x80 | ( cp & 0x3f ) );
+    } else {
+        out += char( 0xf0 | ( cp >> 18 ) );
+        out += char( 0x80 | ( ( cp >> 12 ) & 0x3f ) );
+        out += char( 0x80 | ( ( cp >> 6 ) & 0x3f ) );
+        out += char( 0x80 | ( cp & 0x3f ) );
+    }
+}
+
+static bool parseJsonEscape( const std::string &line, size_t pos, unsigned int &cp )
+{
+    // the four hex digits of a \u escape starting at pos
+    if ( pos + 4 > line.length() ) {
+        return false;
+    }
+    cp = 0;
+    for ( size_t i = pos; i < pos + 4; i++ ) {
+        char c = line[ i ];
+        unsigned int digit;
+        if ( c >= '0' && c <= '9' ) {
+            digit = c - '0';
+        } else if ( c >= 'a' && c <= 'f' ) {
+            digit = c - 'a' + 10;
+        } else if ( c >= 'A' && c <= 'F' ) {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        cp = cp * 16 + digit;
+    }
+    return true;
+}
+
+static bool parseJsonString( const std::string &line, size_t &pos, std::string &out )
+{
+    // pos is on the opening quote
+    out.clear();
+    for ( pos++; pos < line.length(); pos++ ) {
+        char c = line[ pos ];
+        if ( c == '"' ) {
+            pos++;
+            return true;
+        }
+        if ( c != '\\' ) {
+            out += c;
+            continue;
+        }
+        if ( ++pos >= line.length() ) {
+            return false;
+        }
+        switch ( line[ pos ] ) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+            unsigned int cp;
+            if ( parseJsonEscape( line, pos + 1, cp ) == false ) {
+                return false;
+            }
+            pos += 4;
+            // outside the BMP JSON writes a surrogate pair, a lone half is replaced
+            unsigned int low;
+            if ( cp >= 0xd800 && cp < 0xdc00 && line.compare( pos + 1, 2, "\\u" ) == 0
+                    && parseJsonEscape( line, pos + 3, low ) == true && low >= 0xdc00 && low < 0xe000 ) {
+                cp = 0x10000 + ( ( cp - 0xd800 ) << 10 ) + ( low - 0xdc00 );
+                pos += 6;
+            } else if ( cp >= 0xd800 && cp < 0xe000 ) {
+                cp = 0xfffd;
+            }
+            appendUtf8( out, cp );
+            break;
+        }
+        default: out += line[ pos ]; break;
+        }
+    }
+    return false;
+}
+
+static bool parseJsonObject( const std::string &line, std::string fields[ 4 ] )
+{
+    // flat objects only, values that are not strings are skipped
+    size_t pos = line.find( '{' );
+    if ( pos == std::string::npos ) {
+        return false;
+    }
+    pos++;
+    while ( pos < line.length() ) {
+        pos = line.find_first_not_of( " \t,", pos );
+        if ( pos == std::string::npos || line[ pos ] == '}' ) {
+            return true;
+        }
+        std::string key, value;
+        if ( line[ pos ] != '"' || parseJsonString( line, pos, key ) == false ) {
+            return false;
+        }
+        pos = line.find_first_not_of( " \t:", pos );
+        if ( pos == std::string::npos ) {
+            return false;
+        }
+        if ( line[ pos ] == '"' ) {
+            if ( parseJsonString( line, pos, value ) == false ) {
+                return false;
+            }
+        } else {
+            size_t end = line.find_first_of( ",}", pos );
+            value = line.substr( pos, end == std::string::npos ? std::string::npos : end - pos );
+            pos = end == std::string::npos ? line.length() : end;
+            continue;
+        }
+        if ( key == "name" ) {
+            fields[ 0 ] = value;
+        } else if ( key == "hostname" || key == "host" ) {
+            fields[ 1 ] = value;
+        } else if ( key == "group" ) {
+            fields[ 2 ] = value;
+        } else if ( key == "user" ) {
+            fields[ 3 ] = value;
+        }
+    }
+    return true;
+}
+
+/** END record parsing **/
+
+
+/** BEGIN PROVIDER **/
+
+Provider::Provider( std::string name, unsigned int ttl, std::string command )
+    :   name( name ),
+        ttl( ttl ),
+        command( command ),
+        running( false ),
+        child( -1 ),
+        lastAttempt( 0 ),
+        handler( NULL ),
+        handlerContext( NULL )
+{
+    const char *user = getenv( "USER" );
+    defaultUser = user != NULL ? user : "";
+}
+
+Provider::~Provider()
+{
+    // don't wait for a slow inventory on the way out
+    pid_t pid = child;
+    if ( pid > 0 ) {
+        kill( pid, SIGTERM );
+    }
+    if ( worker.joinable() == true ) {
+        worker.join();
+    }
+}
+
+const std::string& Provider::getName() const
+{
+    return name;
+}
+
+std::string Provider::getCacheDirectory()
+{
+    const char *home_path = getenv( "HOME" );
+    return std::string( home_path != NULL ? home_path : "" ) + "/.scc/cache";
+}
+
+std::vector< Provider* > Provider::loadProviders()
+{
+    std::vector< Provider* > providers;
+    const char *home_path = getenv( "HOME" );
+    std::ifstream ifs( ( std::string( home_path != NULL ? home_path : "" ) + "/.scc/providers" ).c_str() );
+    std::string line;
+    while ( std::getline( ifs, line ) ) {
+        std::istringstream iss( line );
+        std::string providerName;
+        unsigned int providerTtl;
+        if ( !( iss >> providerName ) || providerName[ 0 ] == '#' || !( iss >> providerTtl ) ) {
+            continue;
+        }
+        std::string providerCommand;
+        std::getline( iss >> std::ws, providerCommand );
+        if ( providerCommand.empty() == false && providerName.find( '/' ) == std::string::npos ) {
+            providers.push_back( new Provider( providerName, providerTtl, providerCommand ) );
+        }
+    }
+    return providers;
+}
+
+Connection* Provider::parseRecord( const std::string &line ) const
+{
+    std::string fields[ 4 ];
+    size_t start = line.find_first_not_of( " \t\r" );
+    if ( start == std::string::npos ) {
+        return NULL;
+    }
+    if ( line[ start ] == '{' ) {
+        if ( parseJsonObject( line, fields ) == false ) {
+            return NULL;
+        }
+    } else {
+        std::istringstream iss( line );
+        for ( int i = 0; i < 4 && std::getline( iss, fields[ i ], '\t' ); i++ ) {
+            if ( fields[ i ].empty() == false && fields[ i ][ fields[ i ].length() - 1 ] == '\r' ) {
+                fields[ i ].erase( fields[ i ].length() - 1 );
+            }
+        }
+    }
+    if ( fields[ 0 ].empty() == true ) {
+        return NULL;
+    }
+    Connection *connection = new Connection( Connection::sanitize( fields[ 0 ] ),
+                                             Connection::sanitize( fields[ 1 ].empty() ? fields[ 0 ] : fields[ 1 ] ),
+                                             Connection::sanitize( fields[ 2 ].empty() ? name : fields[ 2 ] ),
+                                             Connection::sanitize( fields[ 3 ].empty() ? defaultUser : fields[ 3 ] ),
+                                             "" );
+    connection->setSource( name );
+    return connection;
+}
+
+std::vector< Connection* > Provider::loadCache()
+{
+    std::vector< Connection* > records;
+    std::ifstream ifs( ( getCacheDirectory() + "/" + name ).c_str() );
+    std::string line;
+    while ( std::getline( ifs, line ) ) {
+        Connection *connection = parseRecord( line );
+        if ( connection != NULL ) {
+            records.push_back( connection );
+        }
+    }
+    return records;
+}
+
+bool Provider::writeCache( const std::vector< Connection* > &records )
+{
+    std::string directory = getCacheDirectory();
+    mkdir( directory.c_str(), S_IRWXU );
+    std::string path = directory + "/" + name;
+    std::string temp = path + ".tmp";
+    std::ofstream ofs( temp.c_str() );
+    if ( ofs.is_open() == false ) {
+        return false;
+    }
+    for ( std::vector< Connection* >::const_iterator it = records.begin(); it != records.end(); ++it ) {
+        ofs << (*it)->getName() << '\t' << (*it)->getHostname() << '\t' << (*it)->getGroup() << '\t' << (*it)->getUser() << '\n';
+    }
+    ofs.close();
+    // readers see either the old or the new cache, never half of one
+    return ofs.fail() == false && rename( temp.c_str(), path.c_str() ) == 0;
+}
+
+bool Provider::isStale() const
+{
+    struct stat st;
+    time_t fresh = lastAttempt;
+    if ( stat( ( getCacheDirectory() + "/" + name ).c_str(), &st ) == 0 && st.st_mtime > fresh ) {
+        fresh = st.st_mtime;
+    }
+    // a ttl of 0 would run the command again on every poll
+    time_t interval = ttl > MIN_REFRESH_INTERVAL ? ttl : MIN_REFRESH_INTERVAL;
+    return time( NULL ) >= fresh + interval;
+}
+
+bool Provider::isRefreshing() const
+{
+    return running;
+}
+
+bool Provider::hasCache() const
+{
+    return access( ( getCacheDirectory() + "/" + name ).c_str(), R_OK ) == 0;
+}
+
+void Provider::wait()
+{
+    if ( worker.joinable() == true ) {
+        worker.join();
+    }
+}
+
+void Provider::setRefreshHandler( RefreshHandler handler, void *context )
+{
+    this->handler = handler;
+    handlerContext = context;
+}
+
+void Provider::refreshAsync()
+{
+    if ( running == true ) {
+        return;
+    }
+    if ( worker.joinable() == true ) {
+        worker.join();
+    }
+    lastAttempt = time( NULL );
+    running = true;
+
+    sigset_t all, old;
+    sigfillset( &all );
+    pthread_sigmask( SIG_SETMASK, &all, &old );
+    worker = std::thread( &Provider::refresh, this );
+    pthread_sigmask( SIG_SETMASK, &old, NULL );
+}
+
+void Provider::refresh()
+{
+    // close on exec, or every other command started meanwhile keeps our pipe open
+    int fds[ 2 ];
+    if ( pipe2( fds, O_CLOEXEC ) != 0 ) {
+        running = false;
+        return;
+    }
+    pid_t pid = fork();
+    if ( pid == 0 ) {
+        int null = open( "/dev/null", O_RDWR );
+        dup2( null, 0 );
+        dup2( fds[ 1 ], 1 );
+        dup2( null, 2 );
+        close( fds[ 0 ] );
+        close( fds[ 1 ] );
+        // the UI blocks everything on this thread, the command should not inherit that
+        sigset_t none;
+        sigemptyset( &none );
+        sigprocmask( SIG_SETMASK, &none, NULL );
+        execl( "/bin/sh", "sh", "-c", command.c_str(), (char*)NULL );
+        _exit( 127 );
+    }
+    close( fds[ 1 ] );
+    if ( pid < 0 ) {
+        close( fds[ 0 ] );
+        running = false;
+        return;
+    }
+    child = pid;
+
+    // parse as the output streams in, large inventories never sit in one buffer
+    std::vector< Connection* > records;
+    std::string line;
+    char buffer[ 65536 ];
+    ssize_t n;
+    while ( ( n = read( fds[ 0 ], buffer, sizeof( buffer ) ) ) != 0 ) {
+        if ( n < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            break;
+        }
+        size_t start = 0;
+        for ( ssize_t i = 0; i < n; i++ ) {
+            if ( buffer[ i ] == '\n' ) {
+                line.append( buffer + start, i - start );
+                Connection *connection = parseRecord( line );
+                if ( connection != NULL ) {
+                    records.push_back( connection );
+                }
+                line.clear();
+                start = i + 1;
+            }
+        }
+        line.append( buffer + start, n - start );
+    }
+    if ( line.empty() == false ) {
+        Connection *connection = parseRecord( line );
+        if ( connection != NULL ) {
+            records.push_back( connection );
+        }
+    }
+    close( fds[ 0 ] );
+
+    int status = 0;
+    waitpid( pid, &status, 0 );
+    child = -1;
+
+    // a failing command keeps the old cache, we try again after another ttl
+    if ( WIFEXITED( status ) && WEXITSTATUS( status ) == 0 && writeCache( records ) == true && handler != NULL ) {
+        handler( this, records, handlerContext );
+    }
+    for ( std::vector< Connection* >::iterator it = records.begin(); it != records.end(); ++it ) {
+        delete (*it);
+    }
+    running = false;
+}
+
+/** END PROVIDER **/
@@ -0,0 +1,86 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __PROVIDER__H_
+#define __PROVIDER__H_
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <time.h>
+#include <sys/types.h>
+
+class Connection;
+
+/**
+    An external inventory command listed in ~/.scc/providers as
+
+        <name> <ttl seconds> <command ...>
+
+    The command prints one connection per line on stdout, either TSV
+    (name, hostname[, group[, user]]) or JSON lines with the keys name,
+    hostname (or host), group and user. The output is cached in
+    ~/.scc/cache/<name>, connections from it are read-only and tagged with
+    the provider name as their source.
+
+    A refresh runs on the provider's own thread and hands what it read
+    to the refresh handler on that same thread, never on the caller's.
+**/
+class Provider
+{
+public:
+    // owns the records it is given, runs on the provider's thread
+    typedef void (*RefreshHandler)( Provider *provider, std::vector< Connection* > &records, void *context );
+
+    Provider( std::string name, unsigned int ttl, std::string command );
+    ~Provider();
+
+    const std::string& getName() const;
+    std::vector< Connection* > loadCache();
+    bool isStale() const;
+    bool isRefreshing() const;
+    bool hasCache() const;
+    void refreshAsync();
+    void wait();
+    void setRefreshHandler( RefreshHandler handler, void *context );
+
+    static std::vector< Provider* > loadProviders();
+    static std::string getCacheDirectory();
+
+private:
+    void refresh();
+    bool writeCache( const std::vector< Connection* > &records );
+    Connection* parseRecord( const std::string &line ) const;
+
+    std::string name;
+    unsigned int ttl;
+    std::string command;
+    std::string defaultUser;
+    std::thread worker;
+    std::atomic< bool > running;
+    std::atomic< pid_t > child;
+    time_t lastAttempt;
+    RefreshHandler handler;
+    void *handlerContext;
+};
+
+#endif
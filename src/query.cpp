@@ -0,0 +1,409 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "query.h"
+#include "sshdatabase.h"
+#include "unicode.h"
+#include <algorithm>
+#include <ctype.h>
+#include <string.h>
+
+/** BEGIN folded matching **/
+
+// fields and values are both folded already, what is left are byte compares
+
+static bool globMatch( std::string_view text, std::string_view pattern )
+{
+    // iterative wildcard match, backtracking only to the last '*',
+    // '?' takes a whole character including its accents
+    size_t t = 0, p = 0, star = std::string_view::npos, mark = 0;
+    while ( t < text.length() ) {
+        if ( p < pattern.length() && pattern[ p ] == '?' ) {
+            t = Unicode::next( text, t );
+            p++;
+        } else if ( p < pattern.length() && pattern[ p ] == text[ t ] ) {
+            t++;
+            p++;
+        } else if ( p < pattern.length() && pattern[ p ] == '*' ) {
+            star = p++;
+            mark = t;
+        } else if ( star != std::string_view::npos ) {
+            p = star + 1;
+            mark = Unicode::next( text, mark );
+            t = mark;
+        } else {
+            return false;
+        }
+    }
+    while ( p < pattern.length() && pattern[ p ] == '*' ) {
+        p++;
+    }
+    return p == pattern.length();
+}
+
+static bool matchValue( std::string_view field, QueryMatch match, std::string_view value )
+{
+    switch ( match ) {
+    case MATCH_EXACT:
+        return field == value;
+    case MATCH_PREFIX:
+        return field.length() >= value.length() && field.compare( 0, value.length(), value ) == 0;
+    case MATCH_SUFFIX:
+        return field.length() >= value.length() && field.compare( field.length() - value.length(), value.length(), value ) == 0;
+    case MATCH_CONTAINS:
+        return field.find( value ) != std::string_view::npos;
+    case MATCH_GLOB:
+        return globMatch( field, value );
+    }
+    return false;
+}
+
+/** END folded matching **/
+
+
+/** BEGIN QUERYNODE **/
+
+QueryNode::QueryNode( Type type )
+    :   type( type ),
+        field( FIELD_ANY ),
+        match( MATCH_CONTAINS )
+{
+}
+
+QueryNode::~QueryNode()
+{
+    for ( std::vector< QueryNode* >::iterator it = children.begin(); it != children.end(); ++it ) {
+        delete (*it);
+    }
+    children.clear();
+}
+
+bool QueryNode::matches( const Connection *connection ) const
+{
+    switch ( type ) {
+    case NODE_AND:
+        for ( std::vector< QueryNode* >::const_iterator it = children.begin(); it != children.end(); ++it ) {
+            if ( (*it)->matches( connection ) == false ) {
+                return false;
+            }
+        }
+        return true;
+    case NODE_OR:
+        for ( std::vector< QueryNode* >::const_iterator it = children.begin(); it != children.end(); ++it ) {
+            if ( (*it)->matches( connection ) == true ) {
+                return true;
+            }
+        }
+        return false;
+    case NODE_NOT:
+        return children.front()->matches( connection ) == false;
+    case NODE_CLAUSE:
+        if ( field == FIELD_GROUP && match == MATCH_EXACT ) {
+            // group:prod covers prod itself and everything below it
+            std::string_view group = connection->getSearchKey( FIELD_GROUP );
+            return matchValue( group, MATCH_PREFIX, value ) && ( group.length() == value.length() || group[ value.length() ] == '/' );
+        }
+        // FIELD_ANY is the whole key, a word typed without a field searches all of them
+        return matchValue( connection->getSearchKey( field ), match, value );
+    }
+    return false;
+}
+
+unsigned int QueryNode::getCost() const
+{
+    // rough per connection cost, a group clause is backed by the group tree
+    // and exact matches bail out on the first differing byte
+    unsigned int cost = 0;
+    switch ( type ) {
+    case NODE_AND:
+    case NODE_OR:
+        for ( std::vector< QueryNode* >::const_iterator it = children.begin(); it != children.end(); ++it ) {
+            cost += (*it)->getCost();
+        }
+        return cost;
+    case NODE_NOT:
+        return children.front()->getCost();
+    case NODE_CLAUSE:
+        switch ( match ) {
+        case MATCH_EXACT: cost = 1; break;
+        case MATCH_PREFIX: cost = 2; break;
+        case MATCH_SUFFIX: cost = 3; break;
+        case MATCH_CONTAINS: cost = 4; break;
+        case MATCH_GLOB: cost = 6; break;
+        }
+        if ( field == FIELD_GROUP && match == MATCH_EXACT ) {
+            cost = 0;
+        } else if ( field == FIELD_ANY ) {
+            cost *= 4;
+        }
+        return cost;
+    }
+    return cost;
+}
+
+void QueryNode::optimize()
+{
+    for ( std::vector< QueryNode* >::iterator it = children.begin(); it != children.end(); ++it ) {
+        (*it)->optimize();
+    }
+    // cheapest first, both AND and OR short circuit
+    if ( type == NODE_AND || type == NODE_OR ) {
+        std::stable_sort( children.begin(), children.end(), []( const QueryNode *l, const QueryNode *r ) {
+            return l->getCost() < r->getCost();
+        } );
+    }
+}
+
+/** END QUERYNODE **/
+
+
+/** BEGIN QUERY **/
+
+Query::Query( std::string text )
+    :   position( 0 ),
+        valid( true ),
+        root( NULL )
+{
+    tokenize( text );
+    if ( tokens.empty() == false ) {
+        root = parseOr();
+        if ( position != tokens.size() ) {
+            valid = false;
+        }
+    }
+    if ( valid == true && root != NULL ) {
+        root->optimize();
+        findIndexedGroups();
+    }
+}
+
+Query::~Query()
+{
+    delete root;
+}
+
+bool Query::isValid() const
+{
+    return valid;
+}
+
+bool Query::matches( const Connection *connection ) const
+{
+    return valid == true && ( root == NULL || root->matches( connection ) == true );
+}
+
+const std::vector< std::string >& Query::getIndexedGroups() const
+{
+    return indexedGroups;
+}
+
+void Query::findIndexedGroups()
+{
+    // positive group clauses every match has to satisfy, the caller can
+    // start from the smallest of these subtrees instead of the whole table,
+    // the paths are folded the way the clause compares them
+    std::vector< QueryNode* > required;
+    if ( root->type == QueryNode::NODE_AND ) {
+        required = root->children;
+    } else {
+        required.push_back( root );
+    }
+    for ( std::vector< QueryNode* >::iterator it = required.begin(); it != required.end(); ++it ) {
+        if ( (*it)->type != QueryNode::NODE_CLAUSE || (*it)->field != FIELD_GROUP || (*it)->match != MATCH_EXACT ) {
+            continue;
+        }
+        // the tree drops empty segments, such a path is left to the full scan
+        const std::string &value = (*it)->value;
+        if ( value.empty() == false && value.front() != '/' && value.back() != '/' && value.find( "//" ) == std::string::npos ) {
+            indexedGroups.push_back( value );
+        }
+    }
+}
+
+bool Query::isQuery( std::string_view text )
+{
+    static const char *prefixes[] = { "name:", "host:", "hostname:", "group:", "user:", "ip:" };
+    size_t start = 0;
+    while ( start < text.length() ) {
+        size_t end = text.find( ' ', start );
+        if ( end == std::string_view::npos ) {
+            end = text.length();
+        }
+        size_t word = start;
+        while ( word < end && ( text[ word ] == '-' || text[ word ] == '(' ) ) {
+            word++;
+        }
+        for ( size_t i = 0; i < sizeof( prefixes ) / sizeof( prefixes[ 0 ] ); i++ ) {
+            if ( text.compare( word, strlen( prefixes[ i ] ), prefixes[ i ] ) == 0 ) {
+                return true;
+            }
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+void Query::tokenize( std::string text )
+{
+    std::string current;
+    bool quoted = false;
+    for ( size_t i = 0; i < text.length(); i++ ) {
+        char c = text[ i ];
+        if ( c == '"' ) {
+            quoted = !quoted;
+        } else if ( quoted == true ) {
+            current += c;
+        } else if ( c == ' ' || c == '\t' || c == '(' || c == ')' ) {
+            if ( current.empty() == false ) {
+                tokens.push_back( current );
+                current.clear();
+            }
+            if ( c == '(' || c == ')' ) {
+                tokens.push_back( std::string( 1, c ) );
+            }
+        } else {
+            current += c;
+        }
+    }
+    if ( current.empty() == false ) {
+        tokens.push_back( current );
+    }
+}
+
+QueryNode* Query::parseOr()
+{
+    QueryNode *left = parseAnd();
+    if ( position >= tokens.size() || ( tokens[ position ] != "OR" && tokens[ position ] != "|" ) ) {
+        return left;
+    }
+    QueryNode *node = new QueryNode( QueryNode::NODE_OR );
+    node->children.push_back( left );
+    while ( position < tokens.size() && ( tokens[ position ] == "OR" || tokens[ position ] == "|" ) ) {
+        position++;
+        node->children.push_back( parseAnd() );
+    }
+    return node;
+}
+
+QueryNode* Query::parseAnd()
+{
+    QueryNode *node = new QueryNode( QueryNode::NODE_AND );
+    while ( position < tokens.size() && tokens[ position ] != ")" && tokens[ position ] != "OR" && tokens[ position ] != "|" ) {
+        if ( tokens[ position ] == "AND" ) {
+            position++;
+            continue;
+        }
+        node->children.push_back( parseUnary() );
+    }
+    if ( node->children.empty() == true ) {
+        valid = false;
+    } else if ( node->children.size() == 1 ) {
+        QueryNode *single = node->children.front();
+        node->children.clear();
+        delete node;
+        return single;
+    }
+    return node;
+}
+
+QueryNode* Query::parseUnary()
+{
+    std::string token = tokens[ position++ ];
+    if ( token == "NOT" || token == "-" ) {
+        if ( position >= tokens.size() ) {
+            valid = false;
+            return new QueryNode( QueryNode::NODE_AND );
+        }
+        QueryNode *node = new QueryNode( QueryNode::NODE_NOT );
+        node->children.push_back( parseUnary() );
+        return node;
+    }
+    if ( token == "(" ) {
+        QueryNode *node = parseOr();
+        if ( position < tokens.size() && tokens[ position ] == ")" ) {
+            position++;
+        } else {
+            valid = false;
+        }
+        return node;
+    }
+    if ( token.length() > 1 && token[ 0 ] == '-' ) {
+        QueryNode *node = new QueryNode( QueryNode::NODE_NOT );
+        node->children.push_back( parseClause( token.substr( 1 ) ) );
+        return node;
+    }
+    return parseClause( token );
+}
+
+QueryNode* Query::parseClause( std::string token )
+{
+    QueryNode *node = new QueryNode( QueryNode::NODE_CLAUSE );
+    size_t colon = token.find( ':' );
+    std::string value = token;
+    if ( colon != std::string::npos ) {
+        std::string name = token.substr( 0, colon );
+        value = token.substr( colon + 1 );
+        if ( name == "name" ) {
+            node->field = FIELD_NAME;
+        } else if ( name == "host" || name == "hostname" ) {
+            node->field = FIELD_HOSTNAME;
+        } else if ( name == "group" ) {
+            node->field = FIELD_GROUP;
+        } else if ( name == "user" ) {
+            node->field = FIELD_USER;
+        } else if ( name == "ip" ) {
+            node->field = FIELD_ADDRESS;
+        } else {
+            value = token;
+        }
+    }
+
+    node->rawValue = value;
+    value.clear();
+    Unicode::fold( node->rawValue, value );
+    if ( node->field == FIELD_ANY ) {
+        node->match = MATCH_CONTAINS;
+        node->value = value;
+        return node;
+    }
+
+    // pick the cheapest matcher that expresses the pattern
+    size_t wildcards = std::count( value.begin(), value.end(), '*' ) + std::count( value.begin(), value.end(), '?' );
+    size_t length = value.length();
+    if ( wildcards == 0 ) {
+        node->match = MATCH_EXACT;
+    } else if ( value.find( '?' ) == std::string::npos && wildcards == 1 && value[ length - 1 ] == '*' ) {
+        node->match = MATCH_PREFIX;
+        value.erase( length - 1 );
+    } else if ( value.find( '?' ) == std::string::npos && wildcards == 1 && value[ 0 ] == '*' ) {
+        node->match = MATCH_SUFFIX;
+        value.erase( 0, 1 );
+    } else if ( value.find( '?' ) == std::string::npos && wildcards == 2 && length >= 2 && value[ 0 ] == '*' && value[ length - 1 ] == '*' ) {
+        node->match = MATCH_CONTAINS;
+        value = value.substr( 1, length - 2 );
+    } else {
+        node->match = MATCH_GLOB;
+    }
+    node->value = value;
+    return node;
+}
+
+/** END QUERY **/
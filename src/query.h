@@ -0,0 +1,108 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __QUERY__H_
+#define __QUERY__H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Connection;
+
+/**
+    Field scoped search, e.g.
+
+        host:db* user:root group:prod -name:old ip:10.1.*
+        (group:prod/eu OR group:prod/us) NOT user:admin
+
+    Clauses next to each other are ANDed. A value without '*' or '?' must
+    match the whole field, group:x also matches everything below x.
+    Words without a field behave like the plain search box. Values and
+    fields are compared in their folded form, see Unicode::fold().
+**/
+enum QueryField
+{
+    FIELD_ANY,
+    FIELD_NAME,
+    FIELD_HOSTNAME,
+    FIELD_GROUP,
+    FIELD_USER,
+    FIELD_ADDRESS
+};
+
+enum QueryMatch
+{
+    MATCH_EXACT,
+    MATCH_PREFIX,
+    MATCH_SUFFIX,
+    MATCH_CONTAINS,
+    MATCH_GLOB
+};
+
+class QueryNode
+{
+public:
+    enum Type { NODE_AND, NODE_OR, NODE_NOT, NODE_CLAUSE };
+
+    QueryNode( Type type );
+    ~QueryNode();
+
+    bool matches( const Connection *connection ) const;
+    unsigned int getCost() const;
+    void optimize();
+
+    Type type;
+    std::vector< QueryNode* > children;
+    QueryField field;
+    QueryMatch match;
+    std::string value;
+    std::string rawValue;
+};
+
+class Query
+{
+public:
+    Query( std::string text );
+    ~Query();
+
+    bool isValid() const;
+    bool matches( const Connection *connection ) const;
+    const std::vector< std::string >& getIndexedGroups() const;
+
+    static bool isQuery( std::string_view text );
+
+private:
+    void tokenize( std::string text );
+    QueryNode* parseOr();
+    QueryNode* parseAnd();
+    QueryNode* parseUnary();
+    QueryNode* parseClause( std::string token );
+    void findIndexedGroups();
+
+    std::vector< std::string > tokens;
+    size_t position;
+    bool valid;
+    QueryNode *root;
+    std::vector< std::string > indexedGroups;
+};
+
+#endif
@@ -0,0 +1,77 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#ifndef __RENDERER__H_
+#define __RENDERER__H_
+
+#include <string_view>
+
+// what text is drawn with, STYLE_BOLD can be added to any of the others
+#define STYLE_NORMAL 0
+#define STYLE_ACCENT 1
+#define STYLE_GROUP 2
+#define STYLE_MARKED 3
+#define STYLE_BOLD 0x100
+
+// readInput() found nothing to read
+#define INPUT_NONE -1
+
+// keys that are not characters, numbered past the last code point so
+// they never meet one, control characters come as themselves
+#define K_ENTER 10
+#define K_BACKSPACE 127
+#define K_UP 0x110000
+#define K_DOWN 0x110001
+#define K_LEFT 0x110002
+#define K_RIGHT 0x110003
+#define K_BTAB 0x110004
+
+/**
+    Everything Window puts on the terminal goes through here. The screen
+    is split into panels addressed by the number createPanel() hands out.
+    Drawing into a panel only changes the panel, refreshPanel() stages it
+    for the screen and update() sends everything staged in one go.
+
+    Input comes back as INPUT_NONE when nothing arrived, the K_ codes
+    above and control characters as keys, and printable characters as
+    text. A backend translates its own key codes into these.
+**/
+class Renderer
+{
+public:
+    virtual ~Renderer();
+
+    virtual void getSize( int &rows, int &columns ) const = 0;
+    virtual int createPanel( int rows, int columns, int y, int x ) = 0;
+    virtual void destroyPanel( int panel ) = 0;
+    virtual void getPanelSize( int panel, int &rows, int &columns ) const = 0;
+    virtual void clearPanel( int panel ) = 0;
+    virtual void drawBorder( int panel ) = 0;
+    virtual int print( int panel, int row, int x, std::string_view text, unsigned int style ) = 0;
+    virtual void moveCursor( int panel, int row, int x ) = 0;
+    virtual void refreshPanel( int panel ) = 0;
+    virtual void update() = 0;
+    virtual bool readInput( int panel, int timeout, int &c ) = 0;
+    virtual void beep() = 0;
+};
+
+#endif
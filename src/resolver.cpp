@@ -0,0 +1,286 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "resolver.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#define RESOLVER_WORKERS 8
+#define RESOLVER_TTL 3600
+#define RESOLVER_NEGATIVE_TTL 300
+// answers arriving within this long of each other go out as one batch
+#define RESOLVER_BATCH_MS 250
+
+/** BEGIN RESOLVER **/
+
+Resolver::Resolver()
+    :   busy( 0 ),
+        stopping( false ),
+        dirty( false ),
+        handler( NULL ),
+        handlerContext( NULL )
+{
+}
+
+Resolver::~Resolver()
+{
+    stop();
+}
+
+void Resolver::stop()
+{
+    // what is queued is dropped, lookups in flight are waited for, at most one per worker
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        stopping = true;
+        pending.clear();
+        wakeup.notify_all();
+        answered.notify_all();
+    }
+    for ( std::vector< std::thread >::iterator it = workers.begin(); it != workers.end(); ++it ) {
+        it->join();
+    }
+    workers.clear();
+    if ( publisher.joinable() == true ) {
+        publisher.join();
+    }
+
+    // answers that came in after the last batch still make it into the cache
+    bool save;
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        time_t now = time( NULL );
+        for ( std::vector< std::pair< std::string, std::string > >::iterator it = done.begin(); it != done.end(); ++it ) {
+            Entry &entry = cache[ it->first ];
+            entry.address = it->second;
+            entry.expires = now + ( it->second.empty() == true ? RESOLVER_NEGATIVE_TTL : RESOLVER_TTL );
+            dirty = true;
+        }
+        done.clear();
+        save = dirty;
+    }
+    if ( save == true ) {
+        saveCache();
+    }
+}
+
+std::string Resolver::getCachePath()
+{
+    const char *home_path = getenv( "HOME" );
+    return std::string( home_path != NULL ? home_path : "" ) + "/.scc/resolved";
+}
+
+void Resolver::setResolvedHandler( ResolvedHandler handler, void *context )
+{
+    std::lock_guard< std::mutex > lock( mutex );
+    this->handler = handler;
+    handlerContext = context;
+}
+
+void Resolver::loadCache()
+{
+    std::ifstream ifs( getCachePath().c_str() );
+    std::string line;
+    std::lock_guard< std::mutex > lock( mutex );
+    while ( std::getline( ifs, line ) ) {
+        std::istringstream iss( line );
+        std::string hostname;
+        Entry entry;
+        if ( std::getline( iss, hostname, '\t' ) && std::getline( iss, entry.address, '\t' ) && ( iss >> entry.expires ) ) {
+            cache[ hostname ] = entry;
+        }
+    }
+}
+
+bool Resolver::saveCache()
+{
+    // copied out under the lock, written without it
+    std::ostringstream lines;
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        time_t now = time( NULL );
+        for ( std::unordered_map< std::string, Entry >::iterator it = cache.begin(); it != cache.end(); ++it ) {
+            if ( it->second.expires > now ) {
+                lines << it->first << '\t' << it->second.address << '\t' << it->second.expires << '\n';
+            }
+        }
+        dirty = false;
+    }
+    std::string path = getCachePath();
+    std::string temp = path + ".tmp";
+    std::ofstream ofs( temp.c_str() );
+    if ( ofs.is_open() == false ) {
+        return false;
+    }
+    ofs << lines.str();
+    ofs.close();
+    return ofs.fail() == false && rename( temp.c_str(), path.c_str() ) == 0;
+}
+
+bool Resolver::lookup( const std::string &hostname, std::string &address ) const
+{
+    // an expired address is still the best guess until the refresh lands,
+    // false tells the caller to queue the hostname again
+    std::lock_guard< std::mutex > lock( mutex );
+    std::unordered_map< std::string, Entry >::const_iterator it = cache.find( hostname );
+    if ( it == cache.end() ) {
+        address.clear();
+        return false;
+    }
+    address = it->second.address;
+    return it->second.expires > time( NULL );
+}
+
+void Resolver::enqueue( const std::vector< std::string > &hostnames )
+{
+    std::lock_guard< std::mutex > lock( mutex );
+    if ( stopping == true ) {
+        return;
+    }
+    for ( std::vector< std::string >::const_iterator it = hostnames.begin(); it != hostnames.end(); ++it ) {
+        if ( it->empty() == false && queued.insert( *it ).second == true ) {
+            pending.push_back( *it );
+        }
+    }
+    if ( pending.empty() == true ) {
+        return;
+    }
+
+    // the pool is bounded, the rest of the queue waits its turn
+    sigset_t all, old;
+    sigfillset( &all );
+    pthread_sigmask( SIG_SETMASK, &all, &old );
+    while ( workers.size() < RESOLVER_WORKERS && workers.size() < pending.size() + busy ) {
+        workers.push_back( std::thread( &Resolver::work, this ) );
+    }
+    if ( publisher.joinable() == false ) {
+        publisher = std::thread( &Resolver::publish, this );
+    }
+    pthread_sigmask( SIG_SETMASK, &old, NULL );
+    wakeup.notify_all();
+}
+
+bool Resolver::isResolving() const
+{
+    std::lock_guard< std::mutex > lock( mutex );
+    return pending.empty() == false || busy > 0 || done.empty() == false;
+}
+
+void Resolver::publish()
+{
+    std::unique_lock< std::mutex > lock( mutex );
+    std::vector< std::pair< std::string, std::string > > batch;
+    for (;;) {
+        while ( stopping == false && done.empty() == true ) {
+            answered.wait( lock );
+        }
+        if ( stopping == true ) {
+            return;
+        }
+        // let the answers pile up a little, each batch is a new version of the table
+        answered.wait_for( lock, std::chrono::milliseconds( RESOLVER_BATCH_MS ) );
+        if ( stopping == true ) {
+            return;
+        }
+        batch.swap( done );
+        time_t now = time( NULL );
+        for ( std::vector< std::pair< std::string, std::string > >::iterator it = batch.begin(); it != batch.end(); ++it ) {
+            Entry &entry = cache[ it->first ];
+            entry.address = it->second;
+            entry.expires = now + ( it->second.empty() == true ? RESOLVER_NEGATIVE_TTL : RESOLVER_TTL );
+            queued.erase( it->first );
+        }
+        dirty = true;
+        bool idle = pending.empty() == true && busy == 0;
+        ResolvedHandler current = handler;
+        void *context = handlerContext;
+        // still resolving until the handler has the batch out
+        busy++;
+        lock.unlock();
+
+        if ( current != NULL ) {
+            current( batch, context );
+        }
+        // one write per round of lookups, not one per answer
+        if ( idle == true ) {
+            saveCache();
+        }
+        batch.clear();
+        lock.lock();
+        busy--;
+    }
+}
+
+void Resolver::work()
+{
+    std::unique_lock< std::mutex > lock( mutex );
+    for (;;) {
+        while ( stopping == false && pending.empty() == true ) {
+            wakeup.wait( lock );
+        }
+        if ( stopping == true ) {
+            return;
+        }
+        std::string hostname = pending.front();
+        pending.pop_front();
+        busy++;
+        lock.unlock();
+
+        // take the first address in the order the system prefers them
+        std::string address;
+        struct addrinfo hints;
+        struct addrinfo *result = NULL;
+        memset( &hints, 0, sizeof( hints ) );
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if ( getaddrinfo( hostname.c_str(), NULL, &hints, &result ) == 0 && result != NULL ) {
+            char buffer[ INET6_ADDRSTRLEN ];
+            const void *raw = result->ai_family == AF_INET6
+                ? (const void*)&( (struct sockaddr_in6*)result->ai_addr )->sin6_addr
+                : (const void*)&( (struct sockaddr_in*)result->ai_addr )->sin_addr;
+            if ( inet_ntop( result->ai_family, raw, buffer, sizeof( buffer ) ) != NULL ) {
+                address = buffer;
+            }
+        }
+        if ( result != NULL ) {
+            freeaddrinfo( result );
+        }
+
+        lock.lock();
+        busy--;
+        done.push_back( std::make_pair( hostname, address ) );
+        answered.notify_one();
+    }
+}
+
+/** END RESOLVER **/
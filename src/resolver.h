@@ -0,0 +1,96 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __RESOLVER__H_
+#define __RESOLVER__H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <time.h>
+
+/**
+    Resolves connection hostnames ahead of time on a small pool of worker
+    threads, so a launch does not have to wait for DNS. Results are kept in
+    ~/.scc/resolved as
+
+        <hostname> <address> <expires>
+
+    separated by tabs. Failed lookups are cached with an empty address for
+    a shorter time.
+
+    Answers are collected for a moment and handed to the resolved handler
+    as one batch, on the resolver's own publisher thread. Every thread is
+    joined by stop(), so nothing is left inside getaddrinfo or halfway
+    through ~/.scc/resolved once it returns.
+**/
+class Resolver
+{
+public:
+    // runs on the publisher thread, after the cache already has the batch
+    typedef void (*ResolvedHandler)( const std::vector< std::pair< std::string, std::string > > &resolved, void *context );
+
+    Resolver();
+    ~Resolver();
+
+    bool lookup( const std::string &hostname, std::string &address ) const;
+    void enqueue( const std::vector< std::string > &hostnames );
+    void setResolvedHandler( ResolvedHandler handler, void *context );
+    bool isResolving() const;
+    void loadCache();
+    bool saveCache();
+    void stop();
+
+    static std::string getCachePath();
+
+private:
+    struct Entry
+    {
+        std::string address;
+        time_t expires;
+    };
+
+    void work();
+    void publish();
+
+    // guards everything below, the cache included, lookups come from any thread
+    mutable std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable answered;
+    std::unordered_map< std::string, Entry > cache;
+    std::unordered_set< std::string > queued;
+    std::deque< std::string > pending;
+    std::vector< std::pair< std::string, std::string > > done;
+    std::vector< std::thread > workers;
+    std::thread publisher;
+    unsigned int busy;
+    bool stopping;
+    bool dirty;
+    ResolvedHandler handler;
+    void *handlerContext;
+};
+
+#endif
@@ -20,6 +20,7 @@
 **/
 
 #include "resources.h"
+#include "cursesrenderer.h"
 
 Resources* Resources::instance = NULL;
 
@@ -53,7 +54,7 @@ SSHDatabase* Resources::getSSHDatabase()
 {
     if ( sshDatabase == NULL ) {
         sshDatabase = new SSHDatabase();
-        sshDatabase->loadDatabase();
+        sshDatabase->loadDatabaseAsync();
     }
 
     return sshDatabase;
@@ -62,7 +63,7 @@ SSHDatabase* Resources::getSSHDatabase()
 Window* Resources::getWindow()
 {
     if ( window == NULL ) {
-        window = new Window();
+        window = new Window( new CursesRenderer() );
     }
     return window;
 }
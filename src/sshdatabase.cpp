@@ -21,11 +21,25 @@
 
 #include "sshdatabase.h"
 #include "resources.h"
+#include "daemon.h"
+#include "grouptree.h"
+#include "unicode.h"
+#include "completion.h"
+#include "latency.h"
+#include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <unordered_set>
 #include <sstream>
 #include <fstream>
+#include <signal.h>
+#include <pthread.h>
+
+// edits remembered for undo, each one only holds the connections it touched
+#define MAX_HISTORY 256
+// between the fields of a search key, nobody can type it into a search
+#define KEY_SEPARATOR char(0x1f)
 
 
 /** Connection sorter **/
@@ -35,25 +49,64 @@ bool sortConnections(Connection *l, Connection *r)
     return (l->getName()<r->getName());
 }
 
-std::string toUpperString( std::string s )
+/** END connection sorter **/
+
+static std::shared_ptr< Connection > copyVersion( const Connection *original )
 {
-    std::stringstream ss;
-    for( std::string::iterator it = s.begin(); it != s.end(); ++it ) {
-        ss << char(toupper((*it)));
-    }
-    return ss.str();
+    // the same connection in a new version, everything the file does not hold comes along
+    std::shared_ptr< Connection > copy( new Connection( (Connection*)original ) );
+    copy->setId( original->getId() );
+    copy->setLayer( original->getLayer() );
+    copy->setSource( original->getSource() );
+    copy->setShadowed( original->isShadowed() );
+    return copy;
 }
 
-/** END connection sorter **/
+
+/** Scan predicates **/
+
+static bool isVisible( const Connection *connection, const void *context )
+{
+    return connection->isShadowed() == false;
+}
+
+static bool matchesText( const Connection *connection, const void *context )
+{
+    // the needle is folded like the key, one byte search covers every field
+    const std::string &needle = *(const std::string*)context;
+    return connection->isShadowed() == false && connection->getSearchKey().find( needle ) != std::string::npos;
+}
+
+static bool matchesPattern( const Connection *connection, const void *context )
+{
+    const Pattern *pattern = (const Pattern*)context;
+    return connection->isShadowed() == false
+        && ( pattern->matches( connection->getName() ) == true
+            || pattern->matches( connection->getHostname() ) == true
+            || pattern->matches( connection->getGroup() ) == true
+            || pattern->matches( connection->getUser() ) == true
+            || pattern->matches( connection->getAddress() ) == true );
+}
+
+static bool matchesQuery( const Connection *connection, const void *context )
+{
+    return connection->isShadowed() == false && ( (const Query*)context )->matches( connection );
+}
+
+/** END scan predicates **/
 
 /** BEGIN CONNECTION **/
-Connection::Connection( std::string name, std::string hostname, std::string group, std::string user, std::string password )
+Connection::Connection( const std::string &name, const std::string &hostname, const std::string &group, const std::string &user, const std::string &password )
     :   name( name ),
         hostname( hostname),
         group( group ),
         user( user ),
-        password( password )
+        password( password ),
+        layer( 0 ),
+        id( 0 ),
+        shadowed( false )
 {
+    updateSearchKey();
 }
 
 Connection::Connection( Connection *copy )
@@ -61,7 +114,12 @@ Connection::Connection( Connection *copy )
         hostname( copy->hostname),
         group( copy->group ),
         user( copy->user ),
-        password( copy->password )
+        password( copy->password ),
+        address( copy->address ),
+        searchKey( copy->searchKey ),
+        layer( 0 ),
+        id( 0 ),
+        shadowed( false )
 {
 }
 
@@ -70,82 +128,266 @@ Connection::~Connection()
 {
 }
 
-std::string Connection::getName() const
+const std::string& Connection::getSource() const
+{
+    return source;
+}
+
+void Connection::setSource( const std::string &source )
+{
+    this->source = source;
+}
+
+bool Connection::isReadOnly() const
+{
+    return source.empty() == false;
+}
+
+unsigned int Connection::getLayer() const
+{
+    return layer;
+}
+
+void Connection::setLayer( unsigned int layer )
+{
+    this->layer = layer;
+}
+
+unsigned long long Connection::getId() const
+{
+    return id;
+}
+
+void Connection::setId( unsigned long long id )
+{
+    this->id = id;
+}
+
+bool Connection::isShadowed() const
+{
+    return shadowed;
+}
+
+void Connection::setShadowed( bool shadowed )
+{
+    this->shadowed = shadowed;
+}
+
+const std::string& Connection::getName() const
 {
     return name;
 }
 
-std::string Connection::getHostname() const
+const std::string& Connection::getHostname() const
 {
     return hostname;
 }
 
-std::string Connection::getGroup() const
+const std::string& Connection::getGroup() const
 {
     return group;
 }
 
-std::string Connection::getUser() const
+const std::string& Connection::getUser() const
 {
     return user;
 }
 
-std::string Connection::getPassword() const
+const std::string& Connection::getPassword() const
 {
     return password;
 }
 
-void Connection::setName( std::string name )
+const std::string& Connection::getAddress() const
+{
+    return address;
+}
+
+void Connection::setAddress( const std::string &address )
+{
+    this->address = address;
+    updateSearchKey();
+}
+
+const std::string& Connection::getSearchKey() const
+{
+    return searchKey;
+}
+
+std::string_view Connection::getSearchKey( QueryField field ) const
+{
+    // the fields sit in the key in QueryField order
+    std::string_view key = searchKey;
+    if ( field == FIELD_ANY ) {
+        return key;
+    }
+    size_t start = 0;
+    for ( int i = FIELD_NAME; i < field; i++ ) {
+        start = key.find( KEY_SEPARATOR, start ) + 1;
+    }
+    size_t end = key.find( KEY_SEPARATOR, start );
+    return key.substr( start, end == std::string_view::npos ? end : end - start );
+}
+
+void Connection::updateSearchKey()
+{
+    // folded once here, so a search only compares bytes
+    searchKey.clear();
+    Unicode::fold( name, searchKey );
+    searchKey.push_back( KEY_SEPARATOR );
+    Unicode::fold( hostname, searchKey );
+    searchKey.push_back( KEY_SEPARATOR );
+    Unicode::fold( group, searchKey );
+    searchKey.push_back( KEY_SEPARATOR );
+    Unicode::fold( user, searchKey );
+    searchKey.push_back( KEY_SEPARATOR );
+    Unicode::fold( address, searchKey );
+}
+
+void Connection::setName( const std::string &name )
 {
     this->name = name;
+    updateSearchKey();
 }
 
-void Connection::setHostname( std::string hostname )
+void Connection::setHostname( const std::string &hostname )
 {
     this->hostname = hostname;
+    updateSearchKey();
 }
 
-void Connection::setGroup( std::string group )
+void Connection::setGroup( const std::string &group )
 {
     this->group = group;
+    updateSearchKey();
 }
 
-void Connection::setUser( std::string user )
+void Connection::setUser( const std::string &user )
 {
     this->user = user;
+    updateSearchKey();
 }
 
-void Connection::setPassword( std::string password )
+void Connection::setPassword( const std::string &password )
 {
     this->password = password;
 }
 
-std::string Connection::getCommand()
+std::string Connection::getSshPath()
+{
+    const char *ssh = getenv( "SCC_SSH" );
+    return ssh != NULL && ssh[ 0 ] != '\0' ? ssh : "ssh";
+}
+
+bool Connection::isSshVerbose()
+{
+    // $SCC_SSH is a command line, -v, -vv and so on anywhere in it
+    std::istringstream words( getSshPath() );
+    std::string word;
+    while ( words >> word ) {
+        if ( word.length() > 1 && word[ 0 ] == '-' && word.find_first_not_of( 'v', 1 ) == std::string::npos ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string Connection::getCommand( bool verbose )
 {
+    // the command goes through sh, every field is quoted since providers
+    // and imports fill them in, and -- keeps a leading dash from being an option
     std::stringstream ss;
     if ( getPassword().empty() == false ) {
-        ss << "sshpass -p " << getPassword() << " ";
+        ss << "sshpass -p " << quote( getPassword() ) << " ";
+    }
+    ss << getSshPath() << " ";
+    // the log is what launches are timed by, a -v of the user's own is enough
+    if ( verbose == true && isSshVerbose() == false ) {
+        ss << "-v ";
+    }
+    // skip the lookup in ssh, the alias keeps known_hosts keyed by hostname
+    if ( getenv( "SCC_CONNECT_BY_ADDRESS" ) != NULL && getAddress().empty() == false && getAddress() != getHostname() ) {
+        ss << "-o " << quote( "HostKeyAlias=" + getHostname() ) << " -- " << quote( getUser() + "@" + getAddress() );
+    } else {
+        ss << "-- " << quote( getUser() + "@" + getHostname() );
     }
-    ss << "ssh " << getUser() << "@" << getHostname();
     return ss.str();
 }
 
+std::string Connection::quote( const std::string &value )
+{
+    // inside single quotes sh takes everything literally, a quote itself
+    // has to close the string, be escaped and open it again
+    std::string quoted = "'";
+    for ( std::string::const_iterator it = value.begin(); it != value.end(); ++it ) {
+        if ( *it == '\'' ) {
+            quoted += "'\\''";
+        } else {
+            quoted += *it;
+        }
+    }
+    quoted += "'";
+    return quoted;
+}
+
+std::string Connection::sanitize( std::string value )
+{
+    // for fields from outside, providers and imports: the caches are TSV and
+    // the database splits on 0x1f, no control character makes it into a field
+    for ( std::string::iterator it = value.begin(); it != value.end(); ++it ) {
+        if ( (unsigned char)*it < 0x20 || *it == 0x7f ) {
+            *it = ' ';
+        }
+    }
+    return value;
+}
+
 /** END CONNECTION **/
 
 
 /** BEGIN SSHDATABASE **/
 
 SSHDatabase::SSHDatabase()
-    : runOnExit( NULL )
+    :   runOnExit( NULL ),
+        runOnExitTime( 0 ),
+        nextId( 0 ),
+        writableLayer( 0 ),
+        completionPending( false ),
+        completionStopping( false ),
+        loading( false ),
+        cancelLoad( false ),
+        loadGeneration( 0 ),
+        providerGeneration( 0 ),
+        polledProviderGeneration( 0 ),
+        resolvedGeneration( 0 ),
+        polledResolvedGeneration( 0 ),
+        loadedBytes( 0 ),
+        totalBytes( 0 )
 {
+    loadLayers();
+    resolver.loadCache();
+    resolver.setResolvedHandler( &SSHDatabase::onResolved, this );
 }
 
 SSHDatabase::~SSHDatabase()
 {
-    for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
+    cancelLoad = true;
+    waitForLoad();
+    for ( std::vector< Provider* >::iterator it = providers.begin(); it != providers.end(); ++it ) {
         delete (*it);
     }
-    connections.clear();
+    providers.clear();
+    // the resolver calls back into us, it goes before anything it touches
+    resolver.stop();
+    // a rewrite still asked for goes out before the thread does
+    {
+        std::lock_guard< std::mutex > lock( completionMutex );
+        completionStopping = true;
+        completionWakeup.notify_one();
+    }
+    if ( completionThread.joinable() == true ) {
+        completionThread.join();
+    }
 }
 
 Connection* SSHDatabase::getRunOnExit()
@@ -156,157 +398,1031 @@ Connection* SSHDatabase::getRunOnExit()
 void SSHDatabase::setRunOnExit(Connection *conn)
 {
     runOnExit = conn;
+    runOnExitTime = ShellTimer::getMilliseconds();
+}
+
+unsigned long long SSHDatabase::getRunOnExitTime() const
+{
+    return runOnExitTime;
+}
+
+std::string SSHDatabase::getLayerPath( unsigned int layer ) const
+{
+    return layer > 0 && layer <= layers.size() ? layers[ layer - 1 ].getPath() : "";
+}
+
+std::string SSHDatabase::getDatabasePath()
+{
+    const char *home_path = getenv( "HOME" );
+    return std::string( home_path != NULL ? home_path : "" ) + "/.scc/connections";
 }
 
-void SSHDatabase::loadDatabase()
+void SSHDatabase::loadDatabase( bool allowDaemon )
 {
-    // delete our previous connection database
-    for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
+    startLoad( allowDaemon, false );
+}
+
+void SSHDatabase::loadDatabaseAsync()
+{
+    startLoad( true, true );
+}
+
+void SSHDatabase::loadLayers()
+{
+    layers = Layer::loadSources();
+    for ( unsigned int i = 0; i < layers.size(); i++ ) {
+        if ( layers[ i ].isReadOnly() == false ) {
+            writableLayer = i + 1;
+        }
+    }
+}
+
+void SSHDatabase::startLoad( bool allowDaemon, bool async )
+{
+    waitForLoad();
+    // a refresh still running would swap its output into the new database
+    for ( std::vector< Provider* >::iterator it = providers.begin(); it != providers.end(); ++it ) {
         delete (*it);
     }
-    connections.clear();
+    providers.clear();
+    resetDatabase();
+    loadLayers();
 
-    char *home_path = getenv( "HOME" );
-    char database_path[256];
-    sprintf(database_path,"%s/.scc/connections",home_path);
-    std::ifstream ifs;
-    ifs.open( database_path, std::ifstream::in );
-    if ( ifs.is_open() == true ) {
-        std::string line;
-
-        while (std::getline(ifs, line)) {
-            char data[5][256];
-            char *token;
-            const char del[2] = { 0x1f, 0 };
-            int i = 0;
-            token = strtok((char *)line.c_str(), del);
-            strcpy(data[i++],token);
-            while ( token != NULL ) {
-                token = strtok(NULL, del);
-                if ( token != NULL ) {
-                    strcpy(data[i++],token);
+    providers = Provider::loadProviders();
+    for ( std::vector< Provider* >::iterator it = providers.begin(); it != providers.end(); ++it ) {
+        (*it)->setRefreshHandler( &SSHDatabase::onProviderRefresh, this );
+    }
+
+    if ( async == false ) {
+        parseDatabase( allowDaemon );
+        return;
+    }
+
+    // keep signals on the UI thread, handle_signal tears the whole database down
+    sigset_t all, old;
+    sigfillset( &all );
+    pthread_sigmask( SIG_SETMASK, &all, &old );
+    loading = true;
+    loaderThread = std::thread( &SSHDatabase::parseDatabase, this, allowDaemon );
+    pthread_sigmask( SIG_SETMASK, &old, NULL );
+}
+
+void SSHDatabase::resetDatabase()
+{
+    // drop our previous connection database, the history refers to it
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        connections.publish( ConnectionTable() );
+        undoHistory.clear();
+        redoHistory.clear();
+        groupTree.clear();
+        nameIndex.clear();
+        unresolved.clear();
+    }
+    loadedBytes = 0;
+    totalBytes = 0;
+}
+
+void SSHDatabase::waitForLoad()
+{
+    if ( loaderThread.joinable() == true ) {
+        loaderThread.join();
+    }
+}
+
+bool SSHDatabase::isLoading() const
+{
+    return loading;
+}
+
+unsigned int SSHDatabase::getLoadProgress() const
+{
+    unsigned long long total = totalBytes;
+    if ( total == 0 ) {
+        return 100;
+    }
+    return (unsigned int)( loadedBytes * 100 / total );
+}
+
+unsigned int SSHDatabase::getLoadGeneration() const
+{
+    return loadGeneration;
+}
+
+Connection* SSHDatabase::parseLine( std::string_view line )
+{
+    // split on the unit separator, keeping empty fields (e.g. no password),
+    // the fields are only copied once, into the connection
+    std::string_view data[ 5 ];
+    size_t start = 0;
+    int i = 0;
+    for (;;) {
+        size_t end = line.find( char(0x1f), start );
+        if ( i == 5 ) {
+            return NULL;
+        }
+        data[ i++ ] = line.substr( start, end == std::string_view::npos ? std::string_view::npos : end - start );
+        if ( end == std::string_view::npos ) {
+            break;
+        }
+        start = end + 1;
+    }
+    if ( i != 5 || data[ 0 ].empty() == true ) {
+        return NULL;
+    }
+    return new Connection( std::string( data[ 0 ] ), std::string( data[ 1 ] ), std::string( data[ 2 ] ), std::string( data[ 3 ] ), std::string( data[ 4 ] ) );
+}
+
+void SSHDatabase::publishBatch( std::vector< Connection* > &batch, unsigned long long bytes )
+{
+    std::lock_guard< std::mutex > lock( mutex );
+    std::vector< std::shared_ptr< Connection > > owned;
+    owned.reserve( batch.size() );
+    for ( std::vector< Connection* >::iterator it = batch.begin(); it != batch.end(); ++it ) {
+        prepareConnection( *it );
+        owned.push_back( std::shared_ptr< Connection >( *it ) );
+    }
+    ConnectionTable next = connections.append( owned );
+    for ( std::vector< Connection* >::iterator it = batch.begin(); it != batch.end(); ++it ) {
+        indexConnection( *it, next );
+    }
+    connections.publish( next );
+    batch.clear();
+    loadedBytes = bytes;
+    loadGeneration++;
+    enqueueUnresolved();
+}
+
+void SSHDatabase::parseDatabase( bool allowDaemon )
+{
+    // a resident daemon already has the shared layers and providers parsed,
+    // our own writable layer is always read from disk, it is what we rewrite
+    if ( allowDaemon == true && loadFromDaemon() == true ) {
+        if ( writableLayer > 0 && cancelLoad == false ) {
+            parseLayer( writableLayer - 1, loadedBytes );
+        }
+    } else {
+        unsigned long long base = 0;
+        for ( std::vector< Layer >::iterator it = layers.begin(); it != layers.end(); ++it ) {
+            base += it->getSize();
+        }
+        totalBytes = base;
+
+        // every layer loads on its own, shadowing is sorted out by the index
+        base = 0;
+        for ( unsigned int i = 0; i < layers.size() && cancelLoad == false; i++ ) {
+            parseLayer( i, base );
+            base = loadedBytes;
+        }
+        loadProviderCaches();
+    }
+    if ( cancelLoad == false ) {
+        refreshCompletions();
+    }
+    loading = false;
+}
+
+bool SSHDatabase::loadFromDaemon()
+{
+    DaemonClient client;
+    if ( client.request( DAEMON_OP_SNAPSHOT, "" ) == false ) {
+        return false;
+    }
+
+    // published as it streams in, so the first screenful shows right away,
+    // progress counts records here, the writable layer adds its bytes after
+    std::vector< Connection* > batch;
+    std::vector< std::string > paths;
+    unsigned long long writable = writableLayer > 0 ? layers[ writableLayer - 1 ].getSize() : 0;
+    while ( cancelLoad == false && client.isDone() == false ) {
+        bool placed = client.readBatch( batch, paths );
+        for ( size_t i = 0; i < batch.size() && placed == true; i++ ) {
+            // put each one back on our layer of the same file, providers sit in layer 0
+            placed = paths[ i ].empty() == true;
+            for ( unsigned int l = 0; l < layers.size() && placed == false; l++ ) {
+                if ( layers[ l ].isReadOnly() == true && layers[ l ].getPath() == paths[ i ] ) {
+                    batch[ i ]->setLayer( l + 1 );
+                    placed = true;
                 }
             }
-            if ( i == 5 ) {
-                addConnection( data[0], data[1], data[2], data[3], data[4] );
+        }
+        paths.clear();
+        if ( placed == false ) {
+            // a stalled daemon or one serving other sources, start over from disk
+            for ( std::vector< Connection* >::iterator it = batch.begin(); it != batch.end(); ++it ) {
+                delete (*it);
             }
+            resetDatabase();
+            return false;
         }
+        totalBytes = client.getCount() + writable;
+        publishBatch( batch, loadedBytes + batch.size() );
     }
+    return true;
+}
+
+void SSHDatabase::refreshCompletions()
+{
+    // writeDatabase keeps the cache current, this catches layers that
+    // changed behind our back, e.g. a shared file updated by someone else
+    std::vector< std::string > sources;
+    sources.push_back( Layer::getSourcesPath() );
+    for ( std::vector< Layer >::iterator it = layers.begin(); it != layers.end(); ++it ) {
+        sources.push_back( it->getPath() );
+    }
+    if ( CompletionCache::isStale( sources ) == true ) {
+        CompletionCache::write( getSnapshot() );
+    }
+}
+
+void SSHDatabase::scheduleCompletions()
+{
+    // edits come in faster than the cache is sorted, a run of them is one rewrite
+    std::lock_guard< std::mutex > lock( completionMutex );
+    completionPending = true;
+    if ( completionThread.joinable() == false ) {
+        sigset_t all, old;
+        sigfillset( &all );
+        pthread_sigmask( SIG_SETMASK, &all, &old );
+        completionThread = std::thread( &SSHDatabase::writeCompletions, this );
+        pthread_sigmask( SIG_SETMASK, &old, NULL );
+    }
+    completionWakeup.notify_one();
+}
+
+void SSHDatabase::writeCompletions()
+{
+    std::unique_lock< std::mutex > lock( completionMutex );
+    for (;;) {
+        while ( completionPending == false && completionStopping == false ) {
+            completionWakeup.wait( lock );
+        }
+        if ( completionPending == false ) {
+            return;
+        }
+        completionPending = false;
+        lock.unlock();
+        CompletionCache::write( getSnapshot() );
+        lock.lock();
+    }
+}
+
+void SSHDatabase::parseLayer( unsigned int index, unsigned long long base )
+{
+    std::ifstream ifs;
+    ifs.open( layers[ index ].getPath().c_str(), std::ifstream::in | std::ifstream::binary );
+    if ( ifs.is_open() == false ) {
+        return;
+    }
+
+    // read fixed size chunks and publish what we parsed after each one,
+    // so the UI can show the first screenful long before we are done,
+    // lines are parsed straight from the chunk unless they straddle two
+    std::vector< Connection* > batch;
+    std::string line;
+    std::string source = layers[ index ].isReadOnly() == true ? layers[ index ].getName() : "";
+    unsigned long long bytes = base;
+    char buffer[ 65536 ];
+    while ( cancelLoad == false && ( ifs.read( buffer, sizeof( buffer ) ) || ifs.gcount() > 0 ) ) {
+        size_t length = ifs.gcount();
+        size_t start = 0;
+        for ( const char *newline = (const char*)memchr( buffer, '\n', length ); newline != NULL;
+                newline = (const char*)memchr( buffer + start, '\n', length - start ) ) {
+            size_t pos = newline - buffer;
+            Connection *connection;
+            if ( line.empty() == true ) {
+                connection = parseLine( std::string_view( buffer + start, pos - start ) );
+            } else {
+                line.append( buffer + start, pos - start );
+                connection = parseLine( line );
+                line.clear();
+            }
+            if ( connection != NULL ) {
+                connection->setSource( source );
+                connection->setLayer( index + 1 );
+                batch.push_back( connection );
+            }
+            start = pos + 1;
+        }
+        line.append( buffer + start, length - start );
+        bytes += length;
+        publishBatch( batch, bytes );
+    }
+    if ( line.empty() == false ) {
+        Connection *connection = parseLine( line );
+        if ( connection != NULL ) {
+            connection->setSource( source );
+            connection->setLayer( index + 1 );
+            batch.push_back( connection );
+        }
+    }
+    publishBatch( batch, bytes );
     ifs.close();
 }
 
+void SSHDatabase::loadProviderCaches()
+{
+    // cached provider output shows up right away, stale ones refresh behind it
+    for ( std::vector< Provider* >::iterator it = providers.begin(); it != providers.end() && cancelLoad == false; ++it ) {
+        std::vector< Connection* > batch = (*it)->loadCache();
+        publishBatch( batch, loadedBytes );
+        if ( (*it)->isStale() == true ) {
+            (*it)->refreshAsync();
+        }
+    }
+}
+
+bool SSHDatabase::pollProviders()
+{
+    // called from the event loop, starts what went stale and reports swaps,
+    // the swaps themselves happen on the provider threads
+    if ( loading == true ) {
+        return false;
+    }
+    for ( std::vector< Provider* >::iterator it = providers.begin(); it != providers.end(); ++it ) {
+        if ( (*it)->isRefreshing() == false && (*it)->isStale() == true ) {
+            (*it)->refreshAsync();
+        }
+    }
+    unsigned int generation = providerGeneration;
+    bool changed = generation != polledProviderGeneration;
+    polledProviderGeneration = generation;
+    return changed;
+}
+
+void SSHDatabase::onProviderRefresh( Provider *provider, std::vector< Connection* > &records, void *context )
+{
+    // on the provider's thread, the new version is built and published
+    // here under the writer lock, the event loop only picks it up
+    SSHDatabase *database = (SSHDatabase*)context;
+    database->replaceSource( provider->getName(), records );
+    database->scheduleCompletions();
+    database->providerGeneration++;
+}
+
+void SSHDatabase::waitForUncachedProviders()
+{
+    // headless callers have nothing to show until a provider ran once
+    waitForLoad();
+    for ( std::vector< Provider* >::iterator it = providers.begin(); it != providers.end(); ++it ) {
+        if ( (*it)->hasCache() == false ) {
+            (*it)->wait();
+        }
+    }
+    pollProviders();
+}
+
+bool SSHDatabase::pollResolver()
+{
+    // called from the event loop, the addresses went in on the resolver's thread
+    unsigned int generation = resolvedGeneration;
+    bool changed = generation != polledResolvedGeneration;
+    polledResolvedGeneration = generation;
+    return changed;
+}
+
+void SSHDatabase::onResolved( const std::vector< std::pair< std::string, std::string > > &resolved, void *context )
+{
+    // on the resolver's publisher thread, once per batch of answers, the
+    // stale connections are found lock free and replaced under the lock
+    SSHDatabase *database = (SSHDatabase*)context;
+    std::unordered_map< std::string, std::string > addresses;
+    for ( std::vector< std::pair< std::string, std::string > >::const_iterator it = resolved.begin(); it != resolved.end(); ++it ) {
+        addresses[ it->first ] = it->second;
+    }
+    std::vector< unsigned long long > stale;
+    ConnectionTable snapshot = database->getSnapshot();
+    for ( ConnectionTable::const_iterator it = snapshot.begin(); it != snapshot.end(); ++it ) {
+        std::unordered_map< std::string, std::string >::iterator found = addresses.find( (*it)->getHostname() );
+        if ( found != addresses.end() && found->second != (*it)->getAddress() ) {
+            stale.push_back( (*it)->getId() );
+        }
+    }
+    if ( stale.empty() == true ) {
+        return;
+    }
+
+    {
+        // published connections are never written to, applyChange puts in
+        // copies carrying the cached address, it is not an undoable edit
+        std::lock_guard< std::mutex > lock( database->mutex );
+        Change change;
+        for ( std::vector< unsigned long long >::iterator it = stale.begin(); it != stale.end(); ++it ) {
+            std::shared_ptr< Connection > current = database->connections.get( *it );
+            if ( current != NULL ) {
+                change.removed.push_back( current );
+                change.added.push_back( current );
+            }
+        }
+        database->applyChange( change.removed, change.added );
+    }
+    database->resolvedGeneration++;
+}
+
+bool SSHDatabase::isResolving() const
+{
+    return resolver.isResolving();
+}
+
+bool SSHDatabase::isRefreshing() const
+{
+    for ( std::vector< Provider* >::const_iterator it = providers.begin(); it != providers.end(); ++it ) {
+        if ( (*it)->isRefreshing() == true ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SSHDatabase::replaceSource( const std::string &source, std::vector< Connection* > &records )
+{
+    // swap the whole source in one version, readers never see it half gone
+    std::lock_guard< std::mutex > lock( mutex );
+    Change change;
+    for ( ConnectionTable::const_iterator it = connections.begin(); it != connections.end(); ++it ) {
+        if ( (*it)->getSource() == source ) {
+            change.removed.push_back( connections.get( (*it)->getId() ) );
+        }
+    }
+    for ( std::vector< Connection* >::iterator it = records.begin(); it != records.end(); ++it ) {
+        prepareConnection( *it );
+        change.added.push_back( std::shared_ptr< Connection >( *it ) );
+    }
+    records.clear();
+    applyChange( change.removed, change.added );
+}
+
 void SSHDatabase::writeDatabase()
 {
-    char *home_path = getenv( "HOME" );
-    char database_path[256];
-    sprintf(database_path,"%s/.scc/connections",home_path);
+    // never overwrite the file with a half loaded database
+    waitForLoad();
+    if ( writableLayer == 0 ) {
+        return;
+    }
+    // write from a snapshot, edits made meanwhile land in the next write
+    ConnectionTable snapshot = getSnapshot();
     std::ofstream ofs;
-    ofs.open( database_path, std::ifstream::out );
+    ofs.open( layers[ writableLayer - 1 ].getPath().c_str(), std::ifstream::out );
     if ( ofs.is_open() == true ) {
-        for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
-            ofs << (*it)->getName() << char(0x1f) << (*it)->getHostname() << char(0x1f) << (*it)->getGroup() << char(0x1f) << (*it)->getUser() << char(0x1f) << (*it)->getPassword() << std::endl;
+        for ( ConnectionTable::const_iterator it = snapshot.begin(); it != snapshot.end(); ++it ) {
+            // shared layers and provider connections are never rewritten from here
+            if ( (*it)->isReadOnly() == true || (*it)->getLayer() != writableLayer ) {
+                continue;
+            }
+            ofs << (*it)->getName() << char(0x1f) << (*it)->getHostname() << char(0x1f) << (*it)->getGroup() << char(0x1f) << (*it)->getUser() << char(0x1f) << (*it)->getPassword() << '\n';
         }
     }
     ofs.close();
+    // shell completion reads names from its own file, never the database
+    scheduleCompletions();
+}
+
+bool SSHDatabase::insertConnection( Connection *connection )
+{
+    waitForLoad();
+    std::lock_guard< std::mutex > lock( mutex );
+    Change change;
+    prepareConnection( connection );
+    connection->setLayer( writableLayer );
+    change.added.push_back( std::shared_ptr< Connection >( connection ) );
+    applyChange( change.removed, change.added );
+    recordChange( change );
+    return true;
+}
+
+void SSHDatabase::prepareConnection( Connection *connection )
+{
+    // everything not read from the file is filled in before anyone can see it
+    connection->setId( ++nextId );
+    std::string address;
+    if ( lookupAddress( connection->getHostname(), address ) == true ) {
+        connection->setAddress( address );
+    }
+}
+
+bool SSHDatabase::lookupAddress( const std::string &hostname, std::string &address )
+{
+    // the caller holds the mutex, an unknown address is left alone, a stale
+    // one is used until the refresh queued here comes back
+    bool fresh = resolver.lookup( hostname, address );
+    if ( fresh == false ) {
+        unresolved.push_back( hostname );
+    }
+    return fresh == true || address.empty() == false;
+}
+
+void SSHDatabase::enqueueUnresolved()
+{
+    if ( unresolved.empty() == false ) {
+        resolver.enqueue( unresolved );
+        unresolved.clear();
+    }
+}
+
+void SSHDatabase::applyChange( const std::vector< std::shared_ptr< Connection > > &removed, const std::vector< std::shared_ptr< Connection > > &added )
+{
+    // the caller holds the mutex, every step is O(log n) on the table and
+    // the result goes out as a single new version, the index is brought
+    // up to date before that so shadowing is settled in the version itself
+    ConnectionTable next = connections;
+    for ( std::vector< std::shared_ptr< Connection > >::const_iterator it = removed.begin(); it != removed.end(); ++it ) {
+        // the address refresh may have swapped in a copy since this was recorded
+        std::shared_ptr< Connection > current = next.get( (*it)->getId() );
+        if ( current != NULL ) {
+            unindexConnection( current.get(), next );
+        }
+        next = next.erase( (*it)->getId() );
+    }
+    // the history holds connections with the address they had back then,
+    // whatever comes back in carries the one the resolver has now
+    std::vector< std::shared_ptr< Connection > > placed;
+    placed.reserve( added.size() );
+    for ( std::vector< std::shared_ptr< Connection > >::const_iterator it = added.begin(); it != added.end(); ++it ) {
+        std::string address;
+        if ( lookupAddress( (*it)->getHostname(), address ) == true && address != (*it)->getAddress() ) {
+            std::shared_ptr< Connection > copy = copyVersion( it->get() );
+            copy->setAddress( address );
+            placed.push_back( copy );
+        } else {
+            placed.push_back( *it );
+        }
+    }
+    if ( placed.empty() == false && placed.front()->getId() > next.getLastId() ) {
+        // fresh ids, e.g. an import, go on as one batch
+        next = next.append( placed );
+    } else {
+        for ( std::vector< std::shared_ptr< Connection > >::const_iterator it = placed.begin(); it != placed.end(); ++it ) {
+            next = next.insert( *it );
+        }
+    }
+    for ( std::vector< std::shared_ptr< Connection > >::const_iterator it = placed.begin(); it != placed.end(); ++it ) {
+        indexConnection( it->get(), next );
+    }
+    connections.publish( next );
+    loadGeneration++;
+    enqueueUnresolved();
+}
+
+void SSHDatabase::recordChange( const Change &change )
+{
+    undoHistory.push_back( change );
+    if ( undoHistory.size() > MAX_HISTORY ) {
+        undoHistory.pop_front();
+    }
+    redoHistory.clear();
+}
+
+bool SSHDatabase::undo()
+{
+    waitForLoad();
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        if ( undoHistory.empty() == true ) {
+            return false;
+        }
+        Change change = undoHistory.back();
+        undoHistory.pop_back();
+        applyChange( change.added, change.removed );
+        redoHistory.push_back( change );
+    }
+    writeDatabase();
+    return true;
 }
 
-bool SSHDatabase::addConnection( std::string name, std::string hostname, std::string group, std::string user, std::string password )
+bool SSHDatabase::redo()
 {
-    connections.push_back( new Connection( name, hostname, group, user, password ) );
+    waitForLoad();
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        if ( redoHistory.empty() == true ) {
+            return false;
+        }
+        Change change = redoHistory.back();
+        redoHistory.pop_back();
+        applyChange( change.removed, change.added );
+        undoHistory.push_back( change );
+    }
+    writeDatabase();
+    return true;
+}
+
+bool SSHDatabase::canUndo()
+{
+    std::lock_guard< std::mutex > lock( mutex );
+    return undoHistory.empty() == false;
+}
+
+bool SSHDatabase::canRedo()
+{
+    std::lock_guard< std::mutex > lock( mutex );
+    return redoHistory.empty() == false;
+}
+
+ConnectionTable SSHDatabase::getSnapshot()
+{
+    // a copy is one pointer, later edits never touch what it sees
+    return connections.acquire();
+}
+
+void SSHDatabase::indexConnection( Connection *connection, ConnectionTable &next )
+{
+    // the group tree only holds what is visible, the highest layer wins a name
+    bool shadowed = false;
+    std::vector< Connection* > hidden;
+    std::pair< std::unordered_multimap< std::string, Connection* >::iterator, std::unordered_multimap< std::string, Connection* >::iterator > range = nameIndex.equal_range( connection->getName() );
+    for ( std::unordered_multimap< std::string, Connection* >::iterator it = range.first; it != range.second; ++it ) {
+        if ( it->second->getLayer() > connection->getLayer() ) {
+            shadowed = true;
+        } else if ( it->second->getLayer() < connection->getLayer() ) {
+            hidden.push_back( it->second );
+        }
+    }
+    nameIndex.insert( std::make_pair( connection->getName(), connection ) );
+    connection = setShadowed( connection, shadowed, next );
+    if ( shadowed == true ) {
+        return;
+    }
+    for ( std::vector< Connection* >::iterator it = hidden.begin(); it != hidden.end(); ++it ) {
+        groupTree.remove( *it );
+        setShadowed( *it, true, next );
+    }
+    groupTree.add( connection );
+}
+
+Connection* SSHDatabase::setShadowed( Connection *connection, bool shadowed, ConnectionTable &next )
+{
+    // older versions may hold the connection, so it is never flipped in
+    // place, a copy takes its place in next and in the name index
+    if ( connection->isShadowed() == shadowed ) {
+        return connection;
+    }
+    std::shared_ptr< Connection > copy = copyVersion( connection );
+    copy->setShadowed( shadowed );
+    next = next.insert( copy );
+    std::pair< std::unordered_multimap< std::string, Connection* >::iterator, std::unordered_multimap< std::string, Connection* >::iterator > range = nameIndex.equal_range( connection->getName() );
+    for ( std::unordered_multimap< std::string, Connection* >::iterator it = range.first; it != range.second; ++it ) {
+        if ( it->second == connection ) {
+            it->second = copy.get();
+            break;
+        }
+    }
+    return copy.get();
+}
+
+void SSHDatabase::unindexConnection( Connection *connection, ConnectionTable &next )
+{
+    groupTree.remove( connection );
+    std::pair< std::unordered_multimap< std::string, Connection* >::iterator, std::unordered_multimap< std::string, Connection* >::iterator > range = nameIndex.equal_range( connection->getName() );
+    for ( std::unordered_multimap< std::string, Connection* >::iterator it = range.first; it != range.second; ++it ) {
+        if ( it->second == connection ) {
+            nameIndex.erase( it );
+            break;
+        }
+    }
+
+    // if that was the last of the top layer for this name, the next layer down shows through
+    bool covered = false;
+    bool found = false;
+    unsigned int below = 0;
+    range = nameIndex.equal_range( connection->getName() );
+    for ( std::unordered_multimap< std::string, Connection* >::iterator it = range.first; it != range.second; ++it ) {
+        if ( it->second->getLayer() >= connection->getLayer() ) {
+            covered = true;
+        } else if ( found == false || it->second->getLayer() > below ) {
+            below = it->second->getLayer();
+            found = true;
+        }
+    }
+    if ( covered == true || found == false ) {
+        return;
+    }
+    std::vector< Connection* > shown;
+    for ( std::unordered_multimap< std::string, Connection* >::iterator it = range.first; it != range.second; ++it ) {
+        if ( it->second->getLayer() == below ) {
+            shown.push_back( it->second );
+        }
+    }
+    for ( std::vector< Connection* >::iterator it = shown.begin(); it != shown.end(); ++it ) {
+        groupTree.add( setShadowed( *it, false, next ) );
+    }
+}
+
+unsigned int SSHDatabase::addConnections( std::vector< Connection* > &batch )
+{
+    // one transaction: dedupe by name against the index, then a single write
+    Change change;
+    waitForLoad();
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        std::unordered_set< std::string > seen;
+        for ( std::vector< Connection* >::iterator it = batch.begin(); it != batch.end(); ++it ) {
+            if ( nameIndex.find( (*it)->getName() ) != nameIndex.end() || seen.insert( (*it)->getName() ).second == false ) {
+                delete (*it);
+                continue;
+            }
+            prepareConnection( *it );
+            (*it)->setLayer( writableLayer );
+            change.added.push_back( std::shared_ptr< Connection >( *it ) );
+        }
+        batch.clear();
+        if ( change.added.empty() == false ) {
+            applyChange( change.removed, change.added );
+            recordChange( change );
+        }
+    }
+    if ( change.added.empty() == false ) {
+        writeDatabase();
+    }
+    return change.added.size();
+}
+
+bool SSHDatabase::addConnection( const std::string &name, const std::string &hostname, const std::string &group, const std::string &user, const std::string &password )
+{
+    insertConnection( new Connection( name, hostname, group, user, password ) );
     writeDatabase();
     return true;
 }
 bool SSHDatabase::addConnection( Connection *copy )
 {
     if ( copy != NULL ) {
-        Connection *newCon = new Connection(copy);
-        connections.push_back( newCon );
+        insertConnection( new Connection(copy) );
         writeDatabase();
         return true;
     }
     return false;
 }
 
+bool SSHDatabase::updateConnection( Connection *connection, const std::string &name, const std::string &hostname, const std::string &group, const std::string &user, const std::string &password )
+{
+    if ( connection == NULL ) {
+        return false;
+    }
+    waitForLoad();
+    if ( isHiddenAbove( name ) == true ) {
+        // saved under that name it would never show, refuse it instead
+        return false;
+    }
+    if ( connection->isReadOnly() == true ) {
+        // edits to a shared or provider connection become a local override
+        return addConnection( name, hostname, group, user, password );
+    }
+    {
+        std::lock_guard< std::mutex > lock( mutex );
+        // never edit in place, older versions and the undo history keep the original
+        Change change;
+        std::shared_ptr< Connection > original = connections.get( connection->getId() );
+        if ( original == NULL ) {
+            return false;
+        }
+        std::shared_ptr< Connection > edited( new Connection( original.get() ) );
+        edited->setId( original->getId() );
+        edited->setLayer( original->getLayer() );
+        edited->setName( name );
+        edited->setHostname( hostname );
+        edited->setGroup( group );
+        edited->setUser( user );
+        edited->setPassword( password );
+        if ( hostname != original->getHostname() ) {
+            // the old host's address is no guess for the new one, applyChange looks it up
+            edited->setAddress( "" );
+        }
+        change.removed.push_back( original );
+        change.added.push_back( edited );
+        applyChange( change.removed, change.added );
+        recordChange( change );
+    }
+    writeDatabase();
+    return true;
+}
+
 Connection* SSHDatabase::removeConnection( Connection *connection )
 {
     Connection *newcom = NULL;
-    if ( connection != NULL ) {
-        for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ) {
-            if ( (*it) == connection ) {
-                it = connections.erase(it);
-                if ( it != connections.end() ) {
-                    newcom = (*it);
-                }
-                writeDatabase();
-            } else {
-                ++it;
+    if ( connection != NULL && connection->isReadOnly() == false ) {
+        waitForLoad();
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            Change change;
+            std::shared_ptr< Connection > original = connections.get( connection->getId() );
+            if ( original == NULL ) {
+                return NULL;
             }
+            newcom = connections.findNext( original->getId() );
+            change.removed.push_back( original );
+            applyChange( change.removed, change.added );
+            recordChange( change );
         }
+        writeDatabase();
     }
     return newcom;
 }
 
-std::vector< std::string > SSHDatabase::getGroups()
+std::vector< std::string > SSHDatabase::getGroups( std::string_view parent )
 {
+    std::lock_guard< std::mutex > lock( mutex );
     std::vector< std::string > groups;
-    groups.push_back( "*" );
-    for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it) {
-        if ( std::find(groups.begin(), groups.end(), (*it)->getGroup() ) == groups.end() ) {
-            groups.push_back( (*it)->getGroup() );
+    GroupNode *node = groupTree.find( parent );
+    if ( node != NULL ) {
+        std::vector< GroupNode* > children = node->getChildren();
+        for ( std::vector< GroupNode* >::iterator it = children.begin(); it != children.end(); ++it ) {
+            groups.push_back( (*it)->getPath() );
         }
     }
-    std::sort( groups.begin(), groups.end() );
     return groups;
 }
 
-std::vector< Connection* > SSHDatabase::getConnectionsByGroup( std::string group )
+unsigned int SSHDatabase::getGroupCount( std::string_view group )
+{
+    std::lock_guard< std::mutex > lock( mutex );
+    GroupNode *node = groupTree.find( group == "*" ? std::string_view() : group );
+    return node != NULL ? node->getCount() : 0;
+}
+
+bool SSHDatabase::hasGroup( std::string_view group )
+{
+    std::lock_guard< std::mutex > lock( mutex );
+    return groupTree.find( group ) != NULL;
+}
+
+std::vector< Connection* > SSHDatabase::getConnectionsByGroup( const std::string &group, ConnectionTable *version )
 {
     std::vector< Connection* > retval;
-    if ( group != "*" ) {
-        for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
-            if ( (*it)->getGroup() == group ) {
-                retval.push_back( (*it) );
-            }
-        }
-    } else {
-        retval = connections;
+    ConnectionTable snapshot;
+    getConnectionsByGroup( std::string_view( group ), retval, snapshot );
+    if ( version != NULL ) {
+        *version = snapshot;
     }
-    std::sort( retval.begin(), retval.end(), &sortConnections );
     return retval;
+}
 
+void SSHDatabase::getConnectionsByGroup( std::string_view group, std::vector< Connection* > &results, ConnectionTable &version )
+{
+    if ( group == "*" || group.empty() == true ) {
+        getConnections( std::string_view(), SEARCH_TEXT, results, version );
+        return;
+    }
+    results.clear();
+    {
+        // the whole subtree, without looking at connections outside it
+        std::lock_guard< std::mutex > lock( mutex );
+        GroupNode *node = groupTree.find( group );
+        if ( node != NULL ) {
+            node->collect( results );
+        }
+        version = connections;
+    }
+    std::sort( results.begin(), results.end(), &sortConnections );
 }
 
-Connection* SSHDatabase::getConnectionByName( std::string searchText )
+bool SSHDatabase::isHiddenAbove( const std::string &name )
 {
-    Connection *ret = NULL;
-    for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
-        if ( (*it)->getName() == searchText ) {
-            ret = (*it);
+    // a read-only layer above the writable one wins the name whatever we write
+    std::lock_guard< std::mutex > lock( mutex );
+    std::pair< std::unordered_multimap< std::string, Connection* >::iterator, std::unordered_multimap< std::string, Connection* >::iterator > range = nameIndex.equal_range( name );
+    for ( std::unordered_multimap< std::string, Connection* >::iterator it = range.first; it != range.second; ++it ) {
+        if ( it->second->getLayer() > writableLayer ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Connection* SSHDatabase::getConnectionByName( const std::string &searchText )
+{
+    std::lock_guard< std::mutex > lock( mutex );
+    Connection *found = NULL;
+    std::pair< std::unordered_multimap< std::string, Connection* >::iterator, std::unordered_multimap< std::string, Connection* >::iterator > range = nameIndex.equal_range( searchText );
+    for ( std::unordered_multimap< std::string, Connection* >::iterator it = range.first; it != range.second; ++it ) {
+        if ( found == NULL || it->second->getLayer() > found->getLayer() ) {
+            found = it->second;
+        }
+    }
+    return found;
+}
+
+std::vector< Connection* > SSHDatabase::getConnections( const std::string &searchText, SearchMode mode, ConnectionTable *version )
+{
+    std::vector< Connection* > retval;
+    ConnectionTable snapshot;
+    getConnections( std::string_view( searchText ), mode, retval, snapshot );
+    if ( version != NULL ) {
+        *version = snapshot;
+    }
+    return retval;
+}
+
+void SSHDatabase::getConnections( std::string_view searchText, SearchMode mode, std::vector< Connection* > &results, ConnectionTable &version )
+{
+    // scan whatever version is current without taking the writer lock
+    version = connections.acquire();
+    results.clear();
+    if ( searchText.empty() == true ) {
+        version.collect( &isVisible, NULL, results );
+    } else if ( mode == SEARCH_TEXT ) {
+        // fold the needle once, into a buffer each reader thread keeps
+        static thread_local std::string needle;
+        needle.clear();
+        Unicode::fold( searchText, needle );
+        version.collect( &matchesText, &needle, results );
+    } else {
+        std::shared_ptr< const Pattern > pattern;
+        {
+            std::lock_guard< std::mutex > lock( cacheMutex );
+            pattern = patternCache.get( searchText, mode );
+        }
+        if ( pattern->isValid() == true ) {
+            version.collect( &matchesPattern, pattern.get(), results );
         }
     }
-    return ret;
+    std::sort( results.begin(), results.end(), &sortConnections );
 }
 
-std::vector< Connection* > SSHDatabase::getConnections( std::string searchText )
+std::vector< Connection* > SSHDatabase::queryConnections( const std::string &queryText, ConnectionTable *version )
 {
     std::vector< Connection* > retval;
-    if ( searchText.empty() == false ) {
-        for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
-            if ( toUpperString((*it)->getName()).find(toUpperString(searchText)) != std::string::npos ) {
-                retval.push_back( (*it) );
-            } else if ( toUpperString((*it)->getHostname()).find(toUpperString(searchText)) != std::string::npos ) {
-                retval.push_back( (*it) );
-            } else if ( toUpperString((*it)->getGroup()).find(toUpperString(searchText)) != std::string::npos ) {
-                retval.push_back( (*it) );
-            } else if ( toUpperString((*it)->getUser()).find(toUpperString(searchText)) != std::string::npos ) {
-                retval.push_back( (*it) );
+    ConnectionTable snapshot;
+    queryConnections( std::string_view( queryText ), retval, snapshot );
+    if ( version != NULL ) {
+        *version = snapshot;
+    }
+    return retval;
+}
+
+void SSHDatabase::queryConnections( std::string_view queryText, std::vector< Connection* > &results, ConnectionTable &version )
+{
+    // parse once, retyping the same query only re-runs the predicates
+    std::shared_ptr< const Query > query;
+    {
+        std::lock_guard< std::mutex > lock( cacheMutex );
+        if ( lastQuery == NULL || lastQueryText != queryText ) {
+            lastQueryText.assign( queryText.data(), queryText.length() );
+            lastQuery.reset( new Query( lastQueryText ) );
+        }
+        query = lastQuery;
+    }
+
+    results.clear();
+    if ( query->isValid() == false ) {
+        version = connections.acquire();
+        return;
+    }
+
+    // start from the smallest group subtree the query requires, if any,
+    // the members belong to the version taken alongside them
+    bool indexed = false;
+    const std::vector< std::string > &groups = query->getIndexedGroups();
+    if ( groups.empty() == false ) {
+        std::lock_guard< std::mutex > lock( mutex );
+        // the paths are folded, "prod" also takes in the members of "Prod"
+        std::vector< std::string >::const_iterator smallest = groups.end();
+        unsigned int smallestCount = 0;
+        for ( std::vector< std::string >::const_iterator it = groups.begin(); it != groups.end(); ++it ) {
+            unsigned int count = groupTree.countFolded( *it );
+            if ( smallest == groups.end() || count < smallestCount ) {
+                smallest = it;
+                smallestCount = count;
+            }
+        }
+        if ( smallest != groups.end() ) {
+            groupTree.collectFolded( *smallest, results );
+            version = connections;
+            indexed = true;
+        }
+    }
+    if ( indexed == true ) {
+        // filter the members in place, the group tree only holds visible ones
+        size_t kept = 0;
+        for ( size_t i = 0; i < results.size(); i++ ) {
+            if ( query->matches( results[ i ] ) == true ) {
+                results[ kept++ ] = results[ i ];
             }
         }
+        results.resize( kept );
     } else {
-        retval = connections;
+        version = connections.acquire();
+        version.collect( &matchesQuery, query.get(), results );
+    }
+    std::sort( results.begin(), results.end(), &sortConnections );
+}
+
+std::vector< Connection* > SSHDatabase::search( const std::string &searchText, SearchMode mode, ConnectionTable *version )
+{
+    std::vector< Connection* > retval;
+    ConnectionTable snapshot;
+    search( std::string_view( searchText ), mode, retval, snapshot );
+    if ( version != NULL ) {
+        *version = snapshot;
     }
-    std::sort( retval.begin(), retval.end(), &sortConnections );
     return retval;
 }
 
+void SSHDatabase::search( std::string_view searchText, SearchMode mode, std::vector< Connection* > &results, ConnectionTable &version )
+{
+    if ( mode == SEARCH_TEXT && Query::isQuery( searchText ) == true ) {
+        queryConnections( searchText, results, version );
+    } else {
+        getConnections( searchText, mode, results, version );
+    }
+}
+
 /** END SSHDATABASE **/
@@ -23,36 +23,81 @@
 #define __SSH_DATABASE__H_
 
 #include <string>
+#include <string_view>
 #include <map>
 #include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
+#include "grouptree.h"
+#include "query.h"
+#include "pattern.h"
+#include "provider.h"
+#include "layer.h"
+#include "resolver.h"
+#include "connectiontable.h"
 
 class Connection
 {
 public:
-    Connection( std::string name, std::string hostname, std::string group, std::string user, std::string password );
+    Connection( const std::string &name, const std::string &hostname, const std::string &group, const std::string &user, const std::string &password );
     Connection( Connection *copy );
     ~Connection();
 
-    std::string getName() const;
-    std::string getHostname() const;
-    std::string getGroup() const;
-    std::string getUser() const;
-    std::string getPassword() const;
-
-    void setName( std::string name );
-    void setHostname( std::string hostname );
-    void setGroup( std::string group );
-    void setUser( std::string user );
-    void setPassword( std::string password );
-
-    std::string getCommand();
+    const std::string& getName() const;
+    const std::string& getHostname() const;
+    const std::string& getGroup() const;
+    const std::string& getUser() const;
+    const std::string& getPassword() const;
+    const std::string& getAddress() const;
+    const std::string& getSearchKey() const;
+    std::string_view getSearchKey( QueryField field ) const;
+
+    void setName( const std::string &name );
+    void setHostname( const std::string &hostname );
+    void setGroup( const std::string &group );
+    void setUser( const std::string &user );
+    void setPassword( const std::string &password );
+    void setAddress( const std::string &address );
+
+    const std::string& getSource() const;
+    void setSource( const std::string &source );
+    bool isReadOnly() const;
+    unsigned int getLayer() const;
+    void setLayer( unsigned int layer );
+    unsigned long long getId() const;
+    void setId( unsigned long long id );
+    bool isShadowed() const;
+    void setShadowed( bool shadowed );
+
+    std::string getCommand( bool verbose = false );
+
+    static std::string getSshPath();
+    static bool isSshVerbose();
+    static std::string quote( const std::string &value );
+    static std::string sanitize( std::string value );
 
 private:
+    void updateSearchKey();
+
     std::string name;
     std::string hostname;
     std::string group;
     std::string user;
     std::string password;
+    std::string address;
+    // every field folded for searching, separated by 0x1f, rebuilt by the setters
+    std::string searchKey;
+    std::string source;
+    unsigned int layer;
+    unsigned long long id;
+    // decided by the writer before the connection is published, a change
+    // of visibility later on goes out as a new copy
+    bool shadowed;
 };
 
 class SSHDatabase
@@ -61,22 +106,125 @@ public:
     SSHDatabase();
     ~SSHDatabase();
 
-    bool addConnection( std::string name, std::string hostname, std::string group, std::string user, std::string password );
+    bool addConnection( const std::string &name, const std::string &hostname, const std::string &group, const std::string &user, const std::string &password );
     bool addConnection( Connection *copy );
+    unsigned int addConnections( std::vector< Connection* > &batch );
+    bool updateConnection( Connection *connection, const std::string &name, const std::string &hostname, const std::string &group, const std::string &user, const std::string &password );
     Connection* removeConnection( Connection *connection );
-    void loadDatabase();
-    std::vector< Connection* > getConnections( std::string searchText = "" );
-    Connection* getConnectionByName( std::string searchText );
-    std::vector< Connection* > getConnectionsByGroup( std::string group );
-    std::vector< std::string > getGroups();
+    bool undo();
+    bool redo();
+    bool canUndo();
+    bool canRedo();
+    ConnectionTable getSnapshot();
+    void loadDatabase( bool allowDaemon = true );
+    void loadDatabaseAsync();
+    void waitForLoad();
+    bool isLoading() const;
+    unsigned int getLoadProgress() const;
+    unsigned int getLoadGeneration() const;
+    bool pollProviders();
+    bool isRefreshing() const;
+    void waitForUncachedProviders();
+    bool pollResolver();
+    bool isResolving() const;
+    std::vector< Connection* > getConnections( const std::string &searchText = "", SearchMode mode = SEARCH_TEXT, ConnectionTable *version = NULL );
+    std::vector< Connection* > queryConnections( const std::string &queryText, ConnectionTable *version = NULL );
+    std::vector< Connection* > search( const std::string &searchText, SearchMode mode = SEARCH_TEXT, ConnectionTable *version = NULL );
+    std::vector< Connection* > getConnectionsByGroup( const std::string &group, ConnectionTable *version = NULL );
+    // the same searches into a buffer the caller keeps, once it has grown
+    // to fit the results a repeated search allocates nothing
+    void getConnections( std::string_view searchText, SearchMode mode, std::vector< Connection* > &results, ConnectionTable &version );
+    void queryConnections( std::string_view queryText, std::vector< Connection* > &results, ConnectionTable &version );
+    void search( std::string_view searchText, SearchMode mode, std::vector< Connection* > &results, ConnectionTable &version );
+    void getConnectionsByGroup( std::string_view group, std::vector< Connection* > &results, ConnectionTable &version );
+    Connection* getConnectionByName( const std::string &searchText );
+    bool isHiddenAbove( const std::string &name );
+    std::vector< std::string > getGroups( std::string_view parent = "" );
+    unsigned int getGroupCount( std::string_view group );
+    bool hasGroup( std::string_view group );
     Connection* getRunOnExit();
     void setRunOnExit(Connection *conn);
+    unsigned long long getRunOnExitTime() const;
+
+    std::string getLayerPath( unsigned int layer ) const;
+
+    static std::string getDatabasePath();
 
 private:
+    // one undoable edit, undo takes added back out and puts removed back in
+    struct Change
+    {
+        std::vector< std::shared_ptr< Connection > > removed;
+        std::vector< std::shared_ptr< Connection > > added;
+    };
+
     void writeDatabase();
+    bool insertConnection( Connection *connection );
+    void prepareConnection( Connection *connection );
+    void applyChange( const std::vector< std::shared_ptr< Connection > > &removed, const std::vector< std::shared_ptr< Connection > > &added );
+    bool lookupAddress( const std::string &hostname, std::string &address );
+    void enqueueUnresolved();
+    void recordChange( const Change &change );
+    void indexConnection( Connection *connection, ConnectionTable &next );
+    void unindexConnection( Connection *connection, ConnectionTable &next );
+    Connection* setShadowed( Connection *connection, bool shadowed, ConnectionTable &next );
+    void loadLayers();
+    void startLoad( bool allowDaemon, bool async );
+    void resetDatabase();
+    void parseDatabase( bool allowDaemon );
+    bool loadFromDaemon();
+    void parseLayer( unsigned int index, unsigned long long base );
+    void publishBatch( std::vector< Connection* > &batch, unsigned long long bytes );
+    void loadProviderCaches();
+    void refreshCompletions();
+    void scheduleCompletions();
+    void writeCompletions();
+    void replaceSource( const std::string &source, std::vector< Connection* > &records );
+    static void onProviderRefresh( Provider *provider, std::vector< Connection* > &records, void *context );
+    static void onResolved( const std::vector< std::pair< std::string, std::string > > &resolved, void *context );
+    static Connection* parseLine( std::string_view line );
     Connection *runOnExit;
-
-    std::vector< Connection* > connections;
+    // when the connection was picked, for timing the launch
+    unsigned long long runOnExitTime;
+
+    // the published version, replaced by a single writer holding mutex,
+    // which also guards the group tree and name index; scans go lock free
+    ConnectionTable connections;
+    std::deque< Change > undoHistory;
+    std::deque< Change > redoHistory;
+    unsigned long long nextId;
+    std::vector< Provider* > providers;
+    // provider output sits in layer 0, sources entry i in layer i + 1
+    std::vector< Layer > layers;
+    unsigned int writableLayer;
+    GroupTree groupTree;
+    std::unordered_multimap< std::string, Connection* > nameIndex;
+    std::shared_ptr< const Query > lastQuery;
+    std::string lastQueryText;
+    PatternCache patternCache;
+    Resolver resolver;
+    // hostnames met under the mutex without a fresh address, queued after each publish
+    std::vector< std::string > unresolved;
+    std::mutex mutex;
+    std::mutex cacheMutex;
+    // the completion cache is rewritten on its own thread, edits only ask for it
+    std::thread completionThread;
+    std::mutex completionMutex;
+    std::condition_variable completionWakeup;
+    bool completionPending;
+    bool completionStopping;
+    std::thread loaderThread;
+    std::atomic< bool > loading;
+    std::atomic< bool > cancelLoad;
+    std::atomic< unsigned int > loadGeneration;
+    // bumped by every provider swap, pollProviders reports what it has not seen
+    std::atomic< unsigned int > providerGeneration;
+    unsigned int polledProviderGeneration;
+    // the same for address batches from the resolver
+    std::atomic< unsigned int > resolvedGeneration;
+    unsigned int polledResolvedGeneration;
+    std::atomic< unsigned long long > loadedBytes;
+    std::atomic< unsigned long long > totalBytes;
 };
 
 #endif
@@ -0,0 +1,61 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#ifndef __UNICODE__H_
+#define __UNICODE__H_
+
+#include <string>
+#include <string_view>
+
+/**
+    UTF-8 helpers for searching and drawing.
+
+    fold() appends text in the form searches compare against: precomposed
+    characters are split into base and combining marks, fullwidth forms
+    become plain ASCII and everything is case folded. Both a field and the
+    text typed into the search box go through it, so "CAFÉ", "café" and a
+    decomposed "café" all end up as the same bytes.
+
+    width() and fit() count terminal columns, wide characters take two and
+    combining marks none. Like the case folding they go by C.UTF-8, not by
+    whatever locale the process runs in.
+
+    Bytes that are not valid UTF-8 are passed through as they are.
+**/
+class Unicode
+{
+public:
+    static void fold( std::string_view text, std::string &out );
+    static size_t width( std::string_view text );
+    static size_t fit( std::string_view text, size_t columns );
+    static size_t next( std::string_view text, size_t offset );
+    static void append( std::string &text, unsigned int codepoint );
+    static void popBack( std::string &text );
+
+private:
+    static size_t decode( std::string_view text, size_t offset, unsigned int &codepoint );
+    static void decompose( unsigned int codepoint, std::string &out );
+    static unsigned int foldCase( unsigned int codepoint );
+    static bool isCombining( unsigned int codepoint );
+};
+
+#endif
@@ -26,47 +26,53 @@
 #include <stdlib.h>
 #include "window.h"
 #include "resources.h"
+#include "unicode.h"
 #include <string.h>
-#include <sstream>
+#include <stdio.h>
+#include <limits.h>
+#include <algorithm>
 
-Window::Window()
+Window::Window( Renderer *renderer )
     :	selectedPosition( 0 ),
-      searchText( "" )
+      selectedGroup( 0 ),
+      searchText( "" ),
+      searchMode( SEARCH_TEXT ),
+      latencySort( false ),
+      curConnection( NULL ),
+      renderer( renderer ),
+      firstVisible( 0 ),
+      loadedGeneration( 0 )
 {
-    initscr();
-    noecho();
-    start_color();
     newConText.resize(5);
 }
 
 Window::~Window()
 {
-    delwin( helpWindow );
-    delwin( searchWindow );
-    delwin( connectionWindow );
-    delwin( groupWindow );
-    refresh();
-    endwin();
+    // the renderer puts the terminal back the way it found it
+    delete renderer;
 }
 
 void Window::init()
 {
+    latency.load();
     loadConnections();
     int y,x;
-    getmaxyx( stdscr, y, x );
+    renderer->getSize( y, x );
 
     // help window
-    helpWindow = newwin( 3, x/2 - 2, 1, x/2+1 );
+    helpPanel = renderer->createPanel( 3, x/2 - 2, 1, x/2+1 );
 
     // search window
-    searchWindow = newwin( 3, x/2 - 1, 1, 1 );
-    keypad( searchWindow, true );
+    searchPanel = renderer->createPanel( 3, x/2 - 1, 1, 1 );
 
     // connection window
-    connectionWindow = newwin( y-7, x - 2, 7, 1 );
+    connectionPanel = renderer->createPanel( y-10, x - 2, 7, 1 );
+
+    // detail window
+    detailPanel = renderer->createPanel( 3, x - 2, y-3, 1 );
 
     // group window
-    groupWindow = newwin( 3, x - 2, 4, 1 );
+    groupPanel = renderer->createPanel( 3, x - 2, 4, 1 );
 
 }
 
@@ -76,29 +82,148 @@ void Window::runConnection()
     kill(getpid(), SIGINT);
 }
 
+void Window::toggleMarked()
+{
+    if ( curConnection == NULL ) {
+        return;
+    }
+    // marks go by id, names can repeat and the objects come and go with
+    // reloads, while an edit or an address refresh keeps the id
+    if ( marked.erase( curConnection->getId() ) == 0 ) {
+        marked.insert( curConnection->getId() );
+    }
+    if ( selectedPosition + 1 < connections.size() ) {
+        selectedPosition++;
+        curConnection = connections.at( selectedPosition );
+    }
+}
+
+void Window::markAll()
+{
+    // everything in the current filter, or nothing if that is already marked
+    bool all = true;
+    for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end() && all == true; ++it ) {
+        all = marked.count( (*it)->getId() ) > 0;
+    }
+    for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
+        if ( all == true ) {
+            marked.erase( (*it)->getId() );
+        } else {
+            marked.insert( (*it)->getId() );
+        }
+    }
+}
+
+void Window::launchMarked( LaunchLayout layout )
+{
+    std::vector< Connection* > targets;
+    // the version we draw from holds every connection, filtered or not,
+    // a mark whose connection was deleted since is dropped
+    for ( std::set< unsigned long long >::iterator it = marked.begin(); it != marked.end(); ++it ) {
+        Connection *connection = version.find( *it );
+        if ( connection != NULL ) {
+            targets.push_back( connection );
+        }
+    }
+    if ( marked.empty() == true && curConnection != NULL ) {
+        targets.push_back( curConnection );
+    }
+
+    // unlike enter we stay around for the next batch
+    Launcher launcher( layout );
+    if ( launcher.launch( targets ) == true ) {
+        marked.clear();
+    } else {
+        renderer->beep();
+    }
+    status = launcher.getStatus();
+}
+
 std::string Window::getSearchText()
 {
     return searchText;
 }
 
+void Window::loadGroups()
+{
+    SSHDatabase *database = Resources::Instance()->getSSHDatabase();
+    // climb out of groups that went away underneath us
+    while ( groupPath.empty() == false && database->hasGroup( groupPath ) == false ) {
+        size_t slash = groupPath.rfind( '/' );
+        groupPath = slash == std::string::npos ? "" : groupPath.substr( 0, slash );
+    }
+
+    // first entry is the current level itself, then its direct children
+    groups.clear();
+    groups.push_back( groupPath.empty() == true ? "*" : groupPath );
+    std::vector< std::string > children = database->getGroups( groupPath );
+    groups.insert( groups.end(), children.begin(), children.end() );
+    if ( selectedGroup >= groups.size() ) {
+        selectedGroup = groups.size() - 1;
+    }
+    // counts only move when the database does, draw reads them from here
+    groupCounts.clear();
+    for ( std::vector< std::string >::iterator it = groups.begin(); it != groups.end(); ++it ) {
+        groupCounts.push_back( database->getGroupCount( *it ) );
+    }
+}
+
+std::string_view Window::getGroupLabel( size_t index ) const
+{
+    // the current level shows its full path, its children their last segment
+    std::string_view label = groups[ index ];
+    if ( index > 0 ) {
+        label = label.substr( label.rfind( '/' ) + 1 );
+    }
+    return label;
+}
+
+int Window::getGroupLabelWidth( size_t index ) const
+{
+    // "label (count)"
+    int width = Unicode::width( getGroupLabel( index ) ) + 4;
+    for ( unsigned int count = groupCounts[ index ]; count >= 10; count /= 10 ) {
+        width++;
+    }
+    return width;
+}
+
+bool Window::isGroupSelected() const
+{
+    return selectedGroup > 0 || groupPath.empty() == false;
+}
+
 void Window::loadConnections( bool byGroup )
 {
-    connections.clear();
+    // remember what we have seen before asking, a batch may land in between
+    SSHDatabase *database = Resources::Instance()->getSSHDatabase();
+    unsigned int generation = database->getLoadGeneration();
+    // typing does not change the groups, only rebuild them when something might have
+    if ( byGroup == true || generation != loadedGeneration || groups.empty() == true ) {
+        loadGroups();
+    }
+    loadedGeneration = generation;
+    // our pointers stay valid for as long as we hold the version they came
+    // from, keep the previous one until we are done comparing against it,
+    // the result buffer is reused so a search allocates nothing once it has grown
+    ConnectionTable previous = version;
     if ( byGroup == true ) {
         searchText.clear();
-        connections = Resources::Instance()->getSSHDatabase()->getConnectionsByGroup( groups.at( selectedGroup ) );
+        database->getConnectionsByGroup( groups.at( selectedGroup ), connections, version );
     } else {
-        connections = Resources::Instance()->getSSHDatabase()->getConnections( searchText );
+        database->search( searchText, searchMode, connections, version );
+    }
+    if ( latencySort == true ) {
+        sortByLatency();
     }
 
-    groups = Resources::Instance()->getSSHDatabase()->getGroups();
     if ( connections.empty() == false ) {
         Connection *oldConnection = curConnection;
-        // check if our old connection is in this list
+        // check if our old connection is in this list, an edit keeps the id
         selectedPosition = 0;
         curConnection = connections[ 0 ];
         for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
-            if ( oldConnection == *it ) {
+            if ( oldConnection != NULL && oldConnection->getId() == (*it)->getId() ) {
                 selectedPosition = it - connections.begin();
                 curConnection = *it;
             }
@@ -108,23 +233,60 @@ void Window::loadConnections( bool byGroup )
     }
 }
 
-void Window::appendSearchText( char *add )
+void Window::sortByLatency()
 {
-    searchText.append( add );
+    // slowest first, what was never timed without a prompt keeps its order at the end
+    latencyOrder.clear();
+    for ( size_t i = 0; i < connections.size(); i++ ) {
+        const LatencySummary *summary = latency.find( connections[ i ]->getName() );
+        latencyOrder.push_back( std::make_pair( summary != NULL && summary->runs > 0 ? UINT_MAX - 1 - summary->p50 : UINT_MAX, i ) );
+    }
+    std::sort( latencyOrder.begin(), latencyOrder.end() );
+    unsorted.swap( connections );
+    connections.clear();
+    for ( std::vector< std::pair< unsigned int, size_t > >::iterator it = latencyOrder.begin(); it != latencyOrder.end(); ++it ) {
+        connections.push_back( unsorted[ it->second ] );
+    }
+}
+
+void Window::refreshConnections()
+{
+    // pick up batches published by the background loader without
+    // throwing away what the user has typed so far
+    if ( Resources::Instance()->getSSHDatabase()->getLoadGeneration() != loadedGeneration ) {
+        loadConnections( isGroupSelected() == true && searchText.empty() == true );
+    }
+}
+
+void Window::appendSearchText( int codepoint )
+{
+    Unicode::append( searchText, codepoint );
 }
 
 void Window::popSearchText()
 {
-    if ( searchText.length() > 0 ) {
-        searchText.erase( searchText.end() - 1 );
+    Unicode::popBack( searchText );
+}
+
+void Window::printField( int panel, int row, int x, int columns, std::string_view text, unsigned int style )
+{
+    // cut by display width, never through the middle of a character
+    if ( columns > 0 ) {
+        renderer->print( panel, row, x, text.substr( 0, Unicode::fit( text, columns ) ), style );
     }
 }
 
-void Window::handleInput( int c )
+void Window::handleInput( int c, bool text )
 {
+    status.clear();
+    if ( text == true ) {
+        appendSearchText( c );
+        loadConnections();
+        return;
+    }
     switch ( c ) {
-    case KEY_DOWN:
-        if ( selectedPosition < connections.size() - 1 ) {
+    case K_DOWN:
+        if ( selectedPosition + 1 < connections.size() ) {
             selectedPosition++;
             if ( connections.size() > selectedPosition ) {
                 curConnection = connections.at( selectedPosition );
@@ -134,45 +296,111 @@ void Window::handleInput( int c )
         }
         break;
     case K_CTRL_E:
+        // read-only connections can be edited too, the result is saved as a local override
+        if ( curConnection == NULL ) {
+            renderer->beep();
+            break;
+        }
         addConnectionInteractive( true );
-        loadConnections(selectedGroup > 0);
+        loadConnections( isGroupSelected() );
         break;
     case K_CTRL_K:
         Resources::Instance()->getSSHDatabase()->addConnection( curConnection );
-        loadConnections(selectedGroup > 0);
+        loadConnections( isGroupSelected() );
         break;
     case K_CTRL_N:
         addConnectionInteractive( false );
-        loadConnections(selectedGroup > 0);
+        loadConnections( isGroupSelected() );
         break;
     case K_CTRL_D:
-        curConnection = Resources::Instance()->getSSHDatabase()->removeConnection( curConnection );
-        groups = Resources::Instance()->getSSHDatabase()->getGroups();
-        if ( selectedGroup > groups.size()-1 ) {
-            selectedGroup = groups.size()-1;
+        if ( curConnection != NULL && curConnection->isReadOnly() == true ) {
+            renderer->beep();
+            break;
         }
-        loadConnections(selectedGroup > 0);
+        curConnection = Resources::Instance()->getSSHDatabase()->removeConnection( curConnection );
+        loadConnections( isGroupSelected() );
         if ( selectedPosition == connections.size() && connections.size() > 0 ) {
             selectedPosition = connections.size()-1;
         }
         break;
-    case KEY_ENTER:
     case K_ENTER:
         runConnection();
         break;
-    case KEY_LEFT:
+    case K_LEFT:
         if ( selectedGroup > 0 ) {
             selectedGroup--;
         }
         loadConnections(true);
         break;
-    case KEY_RIGHT:
+    case K_RIGHT:
         if ( selectedGroup+1 < groups.size() ) {
             selectedGroup++;
         }
         loadConnections(true);
         break;
-    case KEY_UP:
+    case K_CTRL_U:
+        // ^Z would suspend us, undo sits on ^U with redo next to it on ^Y
+        if ( Resources::Instance()->getSSHDatabase()->undo() == false ) {
+            renderer->beep();
+        }
+        loadConnections( isGroupSelected() );
+        break;
+    case K_CTRL_Y:
+        if ( Resources::Instance()->getSSHDatabase()->redo() == false ) {
+            renderer->beep();
+        }
+        loadConnections( isGroupSelected() );
+        break;
+    case K_CTRL_T:
+        toggleMarked();
+        break;
+    case K_CTRL_A:
+        markAll();
+        break;
+    case K_CTRL_O:
+        launchMarked( LAUNCH_WINDOWS );
+        break;
+    case K_CTRL_P:
+        launchMarked( LAUNCH_PANES );
+        break;
+    case K_CTRL_X:
+        launchMarked( LAUNCH_SYNCHRONIZED );
+        break;
+    case K_CTRL_L:
+        latencySort = latencySort == false;
+        status = latencySort == true ? "sorted by time to shell, slowest first" : "back to the default order";
+        loadConnections( isGroupSelected() == true && searchText.empty() == true );
+        break;
+    case K_CTRL_R:
+        // cycle plain text -> regex -> glob
+        searchMode = searchMode == SEARCH_TEXT ? SEARCH_REGEX : ( searchMode == SEARCH_REGEX ? SEARCH_GLOB : SEARCH_TEXT );
+        loadConnections();
+        break;
+    case K_CTRL_I:
+        // descend into the highlighted group
+        if ( selectedGroup > 0 ) {
+            groupPath = groups.at( selectedGroup );
+            selectedGroup = 0;
+            loadConnections( true );
+        }
+        break;
+    case K_BTAB:
+        // back up one level, keeping the group we came from highlighted
+        if ( groupPath.empty() == false ) {
+            std::string previous = groupPath;
+            size_t slash = groupPath.rfind( '/' );
+            groupPath = slash == std::string::npos ? "" : groupPath.substr( 0, slash );
+            selectedGroup = 0;
+            loadGroups();
+            for ( size_t i = 1; i < groups.size(); i++ ) {
+                if ( groups[ i ] == previous ) {
+                    selectedGroup = i;
+                }
+            }
+            loadConnections( true );
+        }
+        break;
+    case K_UP:
         if ( selectedPosition > 0 ) {
             selectedPosition--;
             if ( connections.size() > selectedPosition ) {
@@ -182,24 +410,21 @@ void Window::handleInput( int c )
             }
         }
         break;
-    case KEY_BACKSPACE:
     case K_BACKSPACE:
         popSearchText();
         loadConnections();
         break;
-    default:
-        if ( c > 31 && c < 127 ) {
-            appendSearchText( (char*)(&c) );
-            loadConnections();
-        }
-        break;
     }
 }
 
-bool Window::handleNewConnectionInput( int c, bool mode )
+bool Window::handleNewConnectionInput( int c, bool text, bool mode )
 {
+    if ( text == true ) {
+        Unicode::append( newConText[newConLine], c );
+        return true;
+    }
     switch ( c ) {
-    case KEY_UP:
+    case K_UP:
         newConLine--;
         if ( newConLine == -1 ) {
             newConLine = 4;
@@ -207,14 +432,13 @@ bool Window::handleNewConnectionInput( int c, bool mode )
         return true;
         break;
     case 9:
-    case KEY_DOWN:
+    case K_DOWN:
         newConLine++;
         if ( newConLine == 5 ) {
             newConLine = 0;
         }
         return true;
         break;
-    case KEY_ENTER:
     case K_ENTER:
         if ( mode == false ) { // add connection
             Resources::Instance()->getSSHDatabase()->addConnection(newConText[0], newConText[1], newConText[2], newConText[3], newConText[4] );
@@ -222,173 +446,228 @@ bool Window::handleNewConnectionInput( int c, bool mode )
                 newConText[i].clear();
             }
         } else { // edit connection
-            curConnection->setName( newConText[ 0 ] );
-            curConnection->setHostname( newConText[ 1 ] );
-            curConnection->setGroup( newConText[ 2 ] );
-            curConnection->setUser( newConText[ 3 ] );
-            curConnection->setPassword( newConText[ 4 ] );
+            if ( Resources::Instance()->getSSHDatabase()->updateConnection( curConnection, newConText[0], newConText[1], newConText[2], newConText[3], newConText[4] ) == false ) {
+                status = "not saved, a read-only layer above yours holds " + newConText[0];
+                renderer->beep();
+            }
 
         }
         return false;
         break;
-    case KEY_BACKSPACE:
     case K_BACKSPACE:
-        if ( newConText[newConLine].size() > 0 ) {
-            newConText[newConLine].erase(newConText[newConLine].size()-1);
-        }
+        Unicode::popBack( newConText[newConLine] );
         return true;
         break;
-    default:
-        if ( c > 31 && c < 127 ) {
-            newConText[newConLine].append( (char*)(&c) );
-            return true;
-        }
-        break;
     }
     return false;
 }
 
+void Window::drawConnectionDialog( int panel, bool editMode )
+{
+    static const char *labels[] = { "Name: ", "Hostname: ", "Group: ", "Username: ", "Password: " };
+    renderer->clearPanel( panel );
+    renderer->drawBorder( panel );
+    renderer->print( panel, 0, 2, editMode == false ? " Add new connection " : " Edit connection ", STYLE_ACCENT );
+    for ( size_t i = 0; i < newConText.size(); i++ ) {
+        renderer->print( panel, 2+i, 1, labels[ i ], STYLE_ACCENT );
+        if ( i == 4 ) {
+            std::string pass( newConText[i].length(), '*' );
+            renderer->print( panel, 2+i, 12, pass, STYLE_NORMAL );
+        } else {
+            renderer->print( panel, 2+i, 12, newConText[i], STYLE_NORMAL );
+        }
+    }
+    renderer->moveCursor( panel, 2+newConLine, 12 + Unicode::width( newConText[newConLine] ) );
+    renderer->refreshPanel( panel );
+    renderer->update();
+}
+
 void Window::addConnectionInteractive( bool editMode )
 {
     int height = 9;
     int width = 40;
     int y,x;
-    std::string newConnectionText;
-    getmaxyx( stdscr, y, x );
-    WINDOW *newConnection = newwin( height,width,y/2-(height/2),x/2-(width/2) );
-    keypad( newConnection, true );
-    wclear(newConnection);
-    box( newConnection, 0, 0 );
-    wattron( newConnection, COLOR_PAIR(1) );
-    if ( editMode == false ) {
-        mvwprintw( newConnection, 0, 2, " Add new connection ");
-        mvwprintw( newConnection, 2, 1, "Name: ");
-        mvwprintw( newConnection, 3, 1, "Hostname: ");
-        mvwprintw( newConnection, 4, 1, "Group: ");
-        mvwprintw( newConnection, 5, 1, "Username: ");
-        mvwprintw( newConnection, 6, 1, "Password: ");
-        wmove( newConnection, 2, 12 );
-    } else {
+    renderer->getSize( y, x );
+    int newConnection = renderer->createPanel( height,width,y/2-(height/2),x/2-(width/2) );
+    if ( editMode == true ) {
         newConText[0] = curConnection->getName();
         newConText[1] = curConnection->getHostname();
         newConText[2] = curConnection->getGroup();
         newConText[3] = curConnection->getUser();
         newConText[4] = curConnection->getPassword();
-        mvwprintw( newConnection, 0, 2, " Edit connection ");
-        mvwprintw( newConnection, 2, 1, "Name: " );
-        mvwprintw( newConnection, 3, 1, "Hostname: " );
-        mvwprintw( newConnection, 4, 1, "Group: " );
-        mvwprintw( newConnection, 5, 1, "Username: " );
-        mvwprintw( newConnection, 6, 1, "Password: " );
-        wattroff( newConnection, COLOR_PAIR(1) );
-        mvwprintw( newConnection, 2, 12, "%s", newConText[0].c_str());
-        mvwprintw( newConnection, 3, 12, "%s", newConText[1].c_str());
-        mvwprintw( newConnection, 4, 12, "%s", newConText[2].c_str());
-        mvwprintw( newConnection, 5, 12, "%s", newConText[3].c_str());
-        std::string pass;
-        for ( size_t i = 0; i < newConText[4].length(); i++ ) {
-            pass.append("*");
-        }
-        mvwprintw( newConnection, 6, 12, "%s", pass.c_str());
-        wmove( newConnection, 2, 12 + newConText[0].length() );
     }
-    wattroff( newConnection, COLOR_PAIR(1) );
-    wnoutrefresh( newConnection );
-    doupdate();
     newConLine = 0;
-    int c = wgetch( newConnection );
-    while ( handleNewConnectionInput( c, editMode ) == true ) {
-        wclear( newConnection );
-        box( newConnection, 0, 0 );
-        wattron( newConnection, COLOR_PAIR(1) );
-        if ( editMode == false ) {
-            mvwprintw( newConnection, 0, 2, " Add new connection ");
-        } else {
-            mvwprintw( newConnection, 0, 2, " Edit connection ");
-        }
-        mvwprintw( newConnection, 2, 1, "Name: " );
-        mvwprintw( newConnection, 3, 1, "Hostname: " );
-        mvwprintw( newConnection, 4, 1, "Group: " );
-        mvwprintw( newConnection, 5, 1, "Username: " );
-        mvwprintw( newConnection, 6, 1, "Password: " );
-        wattroff( newConnection, COLOR_PAIR(1) );
-        mvwprintw( newConnection, 2, 12, "%s", newConText[0].c_str());
-        mvwprintw( newConnection, 3, 12, "%s", newConText[1].c_str());
-        mvwprintw( newConnection, 4, 12, "%s", newConText[2].c_str());
-        mvwprintw( newConnection, 5, 12, "%s", newConText[3].c_str());
-        std::string pass;
-        for ( size_t i = 0; i < newConText[4].length(); i++ ) {
-            pass.append("*");
-        }
-        mvwprintw( newConnection, 6, 12, "%s", pass.c_str());
-        wmove( newConnection, 2+newConLine, 12 + newConText[newConLine].length());
-        wnoutrefresh( newConnection );
-        doupdate();
-        c = wgetch( newConnection );
-    }
+    int c;
+    bool text;
+    do {
+        drawConnectionDialog( newConnection, editMode );
+        text = renderer->readInput( newConnection, -1, c );
+    } while ( handleNewConnectionInput( c, text, editMode ) == true );
+    renderer->destroyPanel( newConnection );
 }
 
 void Window::draw()
 {
-    wclear( searchWindow );
-    wclear( helpWindow );
-    wclear( connectionWindow );
-    wclear( groupWindow );
+    // sample before refreshing, so the final batch is never left behind
+    SSHDatabase *database = Resources::Instance()->getSSHDatabase();
+    bool loading = database->isLoading();
+    bool refreshing = database->isRefreshing();
+    bool resolving = database->isResolving();
+    database->pollProviders();
+    database->pollResolver();
+    resolving = resolving || database->isResolving();
+    refreshConnections();
+    paint( loading, refreshing );
+    // poll while batches are still arriving, block once everything is in
+    processInput( loading == true ? 50 : ( refreshing == true || resolving == true ? 250 : -1 ) );
+}
+
+void Window::drawFrame()
+{
+    // one frame and at most one waiting key, without polling anything in
+    // the background, so a run of frames only measures the drawing
+    refreshConnections();
+    paint( false, false );
+    processInput( 0 );
+}
+
+void Window::processInput( int timeout )
+{
+    int c;
+    bool text = renderer->readInput( searchPanel, timeout, c );
+    if ( c != INPUT_NONE ) {
+        handleInput( c, text );
+    }
+}
 
-    // make colors
-    init_pair(1,COLOR_YELLOW, COLOR_BLACK);
-    init_pair(2,COLOR_BLUE, COLOR_BLACK);
+void Window::paint( bool loading, bool refreshing )
+{
+    renderer->clearPanel( searchPanel );
+    renderer->clearPanel( helpPanel );
+    renderer->clearPanel( connectionPanel );
+    renderer->clearPanel( groupPanel );
+    renderer->clearPanel( detailPanel );
 
     // draw help
     // ^D - delete
     // ^N - new
     // ^K - duplicate
     // ^E - edit
-    wattron( helpWindow, COLOR_PAIR(1) );
-    mvwprintw( helpWindow, 1, 1, "^D delete | ^N new | ^K duplicate | ^E edit");
-    wattroff( helpWindow, COLOR_PAIR(1) );
-
-    // draw groups
-    size_t g = 0;
+    // ^U - undo, ^Y - redo
+    // ^T - mark, ^A - mark all
+    // ^O/^P/^X - open marked in tmux windows/panes/synchronized panes
+    // ^L - sort by time to shell
+    // cut to the box, a wrapped line would run over the border
+    int rows, columns;
+    renderer->getPanelSize( helpPanel, rows, columns );
+    const char *help = "^D del ^N new ^K dup ^E edit ^U/^Y undo/redo ^T mark ^O/^P/^X tmux ^L latency";
+    printField( helpPanel, 1, 1, columns - 2, status.empty() == false ? status : help, STYLE_ACCENT );
+
+    // draw the group level as a breadcrumb followed by its children,
+    // scrolled so the highlighted entry always fits on the bar
+    renderer->getPanelSize( groupPanel, rows, columns );
+    int barWidth = columns - 2 - ( loading == true || refreshing == true ? 16 : 0 );
+    size_t firstGroup = 0;
+    int span = 0;
+    for ( size_t g = selectedGroup + 1; g-- > 0; ) {
+        span += getGroupLabelWidth( g ) + 1;
+        if ( span > barWidth - 2 ) {
+            break;
+        }
+        firstGroup = g;
+    }
     int gpos = 1;
-    for( std::vector< std::string >::iterator it = groups.begin(); it != groups.end(); ++it ) {
-        if ( g++ == selectedGroup ) {
-            wattron( groupWindow, COLOR_PAIR(2) );
+    if ( firstGroup > 0 ) {
+        renderer->print( groupPanel, 1, gpos, "<", STYLE_NORMAL );
+        gpos += 2;
+    }
+    char count[ 32 ];
+    for( size_t g = firstGroup; g < groups.size() && gpos + getGroupLabelWidth( g ) <= barWidth; g++ ) {
+        unsigned int style = g == selectedGroup ? STYLE_GROUP : STYLE_NORMAL;
+        snprintf( count, sizeof( count ), " (%u)", groupCounts[ g ] );
+        renderer->print( groupPanel, 1, renderer->print( groupPanel, 1, gpos, getGroupLabel( g ), style ), count, style );
+        gpos += getGroupLabelWidth( g ) + 1;
+        if ( g == 0 && groups.size() > 1 ) {
+            renderer->print( groupPanel, 1, gpos, ">", STYLE_NORMAL );
+            gpos += 2;
         }
-        mvwprintw( groupWindow, 1, gpos, "%s", (*it).c_str() );
-        wattroff( groupWindow, COLOR_PAIR(2) );
-        gpos += (*it).length()+1;
     }
 
-    // draw connections
-    unsigned int connectionIndex = 0;
-    for( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
+    // show progress while the background loader is still publishing
+    if ( loading == true ) {
+        snprintf( count, sizeof( count ), "loading %3u%%", Resources::Instance()->getSSHDatabase()->getLoadProgress() );
+        renderer->print( groupPanel, rows / 2, columns - 16, count, STYLE_ACCENT );
+    } else if ( refreshing == true ) {
+        renderer->print( groupPanel, rows / 2, columns - 16, "refreshing...", STYLE_ACCENT );
+    }
+
+    // draw connections, only the rows that fit and keep the selection visible
+    renderer->getPanelSize( connectionPanel, rows, columns );
+    unsigned int visibleRows = rows > 2 ? rows - 2 : 1;
+    if ( selectedPosition < firstVisible ) {
+        firstVisible = selectedPosition;
+    } else if ( selectedPosition >= firstVisible + visibleRows ) {
+        firstVisible = selectedPosition - visibleRows + 1;
+    }
+    if ( firstVisible > connections.size() ) {
+        firstVisible = 0;
+    }
+    // name, hostname, group and user get up to 20 columns each and the
+    // address what is left, a narrow panel splits evenly between all five
+    int pitch = ( columns - 2 ) / 5 < 20 ? ( columns - 2 ) / 5 : 20;
+    unsigned int connectionIndex = firstVisible;
+    for( std::vector< Connection* >::iterator it = connections.begin() + firstVisible; it != connections.end() && connectionIndex < firstVisible + visibleRows; ++it ) {
         // draw background if this is our selected connection
-        if ( connectionIndex == selectedPosition ) {
-            wattron( connectionWindow, COLOR_PAIR(1) );
+        unsigned int style = connectionIndex == selectedPosition ? STYLE_ACCENT : STYLE_NORMAL;
+        if ( marked.empty() == false && marked.count( (*it)->getId() ) > 0 ) {
+            style = connectionIndex == selectedPosition ? STYLE_ACCENT | STYLE_BOLD : STYLE_MARKED | STYLE_BOLD;
         }
 
-        mvwprintw( connectionWindow, 1 + connectionIndex, 1, "%s",(*it)->getName().c_str() );
-        mvwprintw( connectionWindow, 1 + connectionIndex, 21, "%s",(*it)->getHostname().c_str() );
-        mvwprintw( connectionWindow, 1 + connectionIndex, 41, "%s",(*it)->getGroup().c_str() );
-        mvwprintw( connectionWindow, 1 + connectionIndex, 61, "%s",(*it)->getUser().c_str() );
-        wattroff( connectionWindow, COLOR_PAIR(1) );
+        unsigned int row = 1 + connectionIndex - firstVisible;
+        printField( connectionPanel, row, 1, pitch - 1, (*it)->getName(), style );
+        printField( connectionPanel, row, 1 + pitch, pitch - 1, (*it)->getHostname(), style );
+        printField( connectionPanel, row, 1 + pitch * 2, pitch - 1, (*it)->getGroup(), style );
+        printField( connectionPanel, row, 1 + pitch * 3, pitch - 1, (*it)->getUser(), style );
+        printField( connectionPanel, row, 1 + pitch * 4, columns - 2 - pitch * 4, (*it)->getAddress(), style );
         connectionIndex++;
     }
 
+    // draw how long the selected connection took to a shell before
+    renderer->getPanelSize( detailPanel, rows, columns );
+    if ( curConnection != NULL ) {
+        char details[ 160 ];
+        const LatencySummary *summary = latency.find( curConnection->getName() );
+        if ( summary != NULL && summary->runs > 0 ) {
+            snprintf( details, sizeof( details ), "to shell p50 %u ms, p95 %u ms over %u runs, last: teardown %u, spawn %u, connect %u, auth %u ms%s",
+                      summary->p50, summary->p95, summary->runs, summary->last.teardown, summary->last.spawn,
+                      summary->last.connect, summary->last.auth, summary->last.multiplexed == true ? " (master)" : "" );
+        } else if ( summary != NULL ) {
+            snprintf( details, sizeof( details ), "to shell: not timed, all %u launches waited on a prompt", summary->prompted );
+        } else {
+            snprintf( details, sizeof( details ), "to shell: never launched from here" );
+        }
+        printField( detailPanel, 1, 1, 19, curConnection->getName(), STYLE_ACCENT );
+        printField( detailPanel, 1, 21, columns - 22, details, STYLE_NORMAL );
+    }
+
     // draw search box
-    mvwprintw( searchWindow, 1, 1, "Search: %s", getSearchText().c_str() );
-
-    box( searchWindow, 0, 0 );
-    box( connectionWindow, 0, 0 );
-    box( helpWindow, 0, 0 );
-    box( groupWindow, 0, 0 );
-    wnoutrefresh( connectionWindow );
-    wnoutrefresh( helpWindow );
-    wnoutrefresh( groupWindow );
-    wnoutrefresh( searchWindow );
-    doupdate();
-    int c = wgetch(searchWindow);
-    handleInput( c );
+    const char *searchLabel = searchMode == SEARCH_REGEX ? "Regex: " : ( searchMode == SEARCH_GLOB ? "Glob: " : "Search: " );
+    int end = renderer->print( searchPanel, 1, renderer->print( searchPanel, 1, 1, searchLabel, STYLE_NORMAL ), searchText, STYLE_NORMAL );
+    if ( marked.empty() == false ) {
+        snprintf( count, sizeof( count ), "  [%u marked]", (unsigned int)marked.size() );
+        renderer->print( searchPanel, 1, end, count, STYLE_NORMAL );
+    }
+
+    renderer->drawBorder( searchPanel );
+    renderer->drawBorder( connectionPanel );
+    renderer->drawBorder( helpPanel );
+    renderer->drawBorder( groupPanel );
+    renderer->drawBorder( detailPanel );
+    renderer->refreshPanel( connectionPanel );
+    renderer->refreshPanel( detailPanel );
+    renderer->refreshPanel( helpPanel );
+    renderer->refreshPanel( groupPanel );
+    renderer->refreshPanel( searchPanel );
+    renderer->update();
 }
 
@@ -52,45 +52,79 @@
 #define K_CTRL_X 24
 #define K_CTRL_Y 25
 #define K_CTRL_Z 26
-#define K_ENTER 10
-#define K_BACKSPACE 127
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <set>
 #include "sshdatabase.h"
-#include <ncursesw/curses.h>
+#include "launcher.h"
+#include "renderer.h"
+#include "latency.h"
 
+/**
+    The interactive screen. It only draws through its renderer, which it
+    owns, so it runs just the same on a terminal or headless.
+**/
 class Window
 {
 public:
-    Window();
+    Window( Renderer *renderer );
     ~Window();
 
     void init();
     void draw();
+    void drawFrame();
 
 private:
+    void loadGroups();
     void loadConnections( bool byGroup = false );
+    std::string_view getGroupLabel( size_t index ) const;
+    int getGroupLabelWidth( size_t index ) const;
+    bool isGroupSelected() const;
+    void sortByLatency();
+    void refreshConnections();
     void runConnection();
-    void handleInput( int c );
-    bool handleNewConnectionInput( int c, bool mode );
+    void toggleMarked();
+    void markAll();
+    void launchMarked( LaunchLayout layout );
+    void paint( bool loading, bool refreshing );
+    void processInput( int timeout );
+    void printField( int panel, int row, int x, int columns, std::string_view text, unsigned int style );
+    void handleInput( int c, bool text );
+    bool handleNewConnectionInput( int c, bool text, bool mode );
     std::string getSearchText();
-    void appendSearchText( char *add );
+    void appendSearchText( int codepoint );
     void popSearchText();
     void addConnectionInteractive( bool editMode );
+    void drawConnectionDialog( int panel, bool editMode );
 
     unsigned int selectedPosition;
     unsigned int selectedGroup;
     std::string searchText;
+    SearchMode searchMode;
     std::vector< Connection* > connections;
+    std::vector< Connection* > unsorted;
+    std::vector< std::pair< unsigned int, size_t > > latencyOrder;
+    LatencyHistory latency;
+    bool latencySort;
+    ConnectionTable version;
     std::vector< std::string > groups;
+    std::vector< unsigned int > groupCounts;
+    std::string groupPath;
     std::vector< std::string > newConText;
+    std::set< unsigned long long > marked;
+    std::string status;
     Connection *curConnection;
-    WINDOW *helpWindow;
-    WINDOW *searchWindow;
-    WINDOW *connectionWindow;
-    WINDOW *groupWindow;
+    Renderer *renderer;
+    int helpPanel;
+    int searchPanel;
+    int connectionPanel;
+    int groupPanel;
+    int detailPanel;
     int newConLine;
+    unsigned int firstVisible;
+    unsigned int loadedGeneration;
 };
 
 #endif
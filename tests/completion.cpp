@@ -0,0 +1,116 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+
+/**
+    Shell completion reads ~/.scc/completions, sorted "g\t<group>" and
+    "n\t<name>" lines that are mapped and binary searched for a prefix.
+    The database rewrites the file on its own thread after each edit.
+
+    Writes the cache from a database with a hidden connection in it and
+    completes names and groups at both ends of the file, then checks an
+    edit reaches the file while the database is still running.
+**/
+
+#include "completion.h"
+#include "sshdatabase.h"
+#include "testing.h"
+#include <stdio.h>
+#include <unistd.h>
+
+#define TEST_TIMEOUT_MS 5000
+
+static std::string join( const std::vector< std::string_view > &words )
+{
+    std::string joined;
+    for ( std::vector< std::string_view >::const_iterator it = words.begin(); it != words.end(); ++it ) {
+        joined += joined.empty() == true ? "" : " ";
+        joined.append( it->data(), it->length() );
+    }
+    return joined;
+}
+
+static std::string complete( CompletionKind kind, std::string_view prefix, size_t limit = 100 )
+{
+    CompletionCache cache;
+    if ( cache.open() == false ) {
+        return "<no cache>";
+    }
+    return join( cache.complete( kind, prefix, limit ) );
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    home.writeFile( ".scc/shared", TestHome::record( "web", "web.shared", "team", "deploy" )
+                                   + TestHome::record( "zulu", "zulu.shared", "team", "deploy" ) );
+    home.writeFile( ".scc/connections", TestHome::record( "web", "web.example", "prod/eu", "deploy" )
+                                        + TestHome::record( "web-01", "web1.example", "prod/us", "deploy" )
+                                        + TestHome::record( "db", "db.example", "prod", "deploy" )
+                                        + TestHome::record( "app", "app.example", "", "deploy" ) );
+    home.writeFile( ".scc/sources", "ro ~/.scc/shared\nrw ~/.scc/connections\n" );
+
+    int failures = 0;
+    {
+        SSHDatabase database;
+        database.loadDatabase( false );
+        failures += expect( CompletionCache::write( database.getSnapshot() ) == true, "the cache is written" );
+
+        failures += expect( complete( COMPLETE_NAME, "we" ) == "web web-01", "names by prefix, a hidden name only once: %s", complete( COMPLETE_NAME, "we" ).c_str() );
+        failures += expect( complete( COMPLETE_NAME, "" ) == "app db web web-01 zulu", "every name for an empty prefix" );
+        failures += expect( complete( COMPLETE_NAME, "app" ) == "app" && complete( COMPLETE_NAME, "zu" ) == "zulu",
+                            "the first and the last line of the file" );
+        failures += expect( complete( COMPLETE_NAME, "x" ).empty() == true && complete( COMPLETE_NAME, "~" ).empty() == true
+                            && complete( COMPLETE_NAME, "a", 0 ).empty() == true,
+                            "nothing past the end or past the limit" );
+        failures += expect( complete( COMPLETE_NAME, "web", 1 ) == "web", "the limit stops the scan" );
+        failures += expect( complete( COMPLETE_GROUP, "pro" ) == "prod prod/eu prod/us" && complete( COMPLETE_GROUP, "prod/" ) == "prod/eu prod/us",
+                            "groups and their parents: %s", complete( COMPLETE_GROUP, "pro" ).c_str() );
+        failures += expect( complete( COMPLETE_GROUP, "" ) == "prod prod/eu prod/us team", "no group line for a connection without one" );
+
+        // written behind the edit, not by it
+        database.addConnection( "api", "api.example", "prod/ap", "deploy", "" );
+        std::string found;
+        for ( unsigned int waited = 0; waited < TEST_TIMEOUT_MS && found.empty() == true; waited += 10 ) {
+            usleep( 10000 );
+            found = complete( COMPLETE_NAME, "ap" );
+        }
+        failures += expect( found == "api app" && complete( COMPLETE_GROUP, "prod/a" ) == "prod/ap",
+                            "an edit reaches the cache while the database runs" );
+        database.removeConnection( database.getConnectionByName( "api" ) );
+    }
+    failures += expect( complete( COMPLETE_NAME, "ap" ) == "app", "the last rewrite is done before the database is gone" );
+
+    // a file someone else wrote, without a final newline
+    home.writeFile( ".scc/completions", "g\tonly\nn\tlast" );
+    failures += expect( complete( COMPLETE_NAME, "la" ) == "last" && complete( COMPLETE_GROUP, "" ) == "only",
+                        "a last line without a newline" );
+    home.writeFile( ".scc/completions", "" );
+    failures += expect( complete( COMPLETE_NAME, "" ).empty() == true, "an empty cache offers nothing" );
+    unlink( home.getPath( ".scc/completions" ).c_str() );
+    failures += expect( complete( COMPLETE_NAME, "" ) == "<no cache>", "a missing cache is reported" );
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+#!/bin/sh
+# the bash, zsh and fish completion scripts against a scratch database:
+# names after connect, nothing but --regex and --glob after --list, which
+# takes search text, and file names after --import. zsh and fish are
+# skipped when they are not installed
+#
+# usage: completion.sh <path to scc>
+
+SCC=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+HOME=$(mktemp -d /tmp/scc-test-XXXXXX) || exit 1
+export HOME
+trap 'rm -rf "$HOME"' EXIT
+mkdir -p "$HOME/.scc" "$HOME/bin"
+printf 'web\037web.example\037prod/eu\037deploy\037\nweb-01\037web1.example\037prod/us\037deploy\037\ndb\037db.example\037prod\037deploy\037\n' > "$HOME/.scc/connections"
+# the scripts call scc from PATH
+ln -s "$SCC" "$HOME/bin/scc"
+PATH="$HOME/bin:$PATH"
+export PATH
+
+fail() {
+    echo "FAIL: $*"
+    exit 1
+}
+
+# prints the candidates one per line: <shell> <words...>, the last one is completed
+complete_bash() {
+    bash -c '
+        eval "$( scc --completion-script bash )"
+        COMP_WORDS=( "$@" )
+        COMP_CWORD=$(( $# - 1 ))
+        _scc
+        [ ${#COMPREPLY[@]} -gt 0 ] && printf "%s\n" "${COMPREPLY[@]}"
+        exit 0' sh "$@"
+}
+
+complete_zsh() {
+    zsh -fc '
+        compadd() { if [[ $1 == -a ]]; then print -rl -- ${(P)2}; else shift; print -rl -- "$@"; fi }
+        compdef() { : }
+        _files() { print -r -- "<files>" }
+        eval "$( scc --completion-script zsh )"
+        words=( "$@" )
+        CURRENT=$#
+        PREFIX=$words[-1]
+        _scc' sh "$@"
+}
+
+complete_fish() {
+    scc --completion-script fish > "$HOME/scc.fish"
+    fish -c "source $HOME/scc.fish; complete -C '$*'" | cut -f 1
+}
+
+check() {
+    shell=$1
+    shift
+    [ "$(complete_$shell scc connect we | sort | tr '\n' ' ')" = "web web-01 " ] || fail "$shell: names after connect"
+    [ -z "$(complete_$shell scc --list pro)" ] || fail "$shell: offers words for --list search text"
+    [ "$(complete_$shell scc --list - | sort | tr '\n' ' ')" = "--glob --regex " ] || fail "$shell: --list options"
+    [ "$(complete_$shell scc --completion-script z)" = "zsh" ] || fail "$shell: --completion-script"
+    echo "ok   $shell completion"
+}
+
+command -v bash > /dev/null || fail "bash is needed"
+# the cache is written on first use
+check bash
+[ -f "$HOME/.scc/completions" ] || fail "no cache written"
+for shell in zsh fish; do
+    if command -v $shell > /dev/null; then
+        check $shell
+    else
+        echo "skip $shell completion, $shell is not installed"
+    fi
+done
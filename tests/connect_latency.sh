@@ -0,0 +1,60 @@
+#!/bin/sh
+# scc connect against a stand-in ssh: the launch is recorded in
+# ~/.scc/latency, and one that asked for a password is flagged as prompted.
+# -v is only added for timing, and not when $SCC_SSH already has one
+#
+# usage: connect_latency.sh <path to scc>
+
+SCC=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+HOME=$(mktemp -d /tmp/scc-test-XXXXXX) || exit 1
+export HOME
+trap 'rm -rf "$HOME"' EXIT
+mkdir -p "$HOME/.scc"
+printf 'web\037web.example\037prod\037deploy\037\n' > "$HOME/.scc/connections"
+
+# logs what ssh -v would, a little apart so every phase takes some time
+cat > "$HOME/ssh" <<'FAKE'
+#!/bin/sh
+echo "OpenSSH_9.2p1 stand-in" >&2
+echo "debug1: Connecting to web.example [10.0.0.1] port 22." >&2
+sleep 0.05
+echo "debug1: Connection established." >&2
+if [ -n "$FAKE_PROMPT" ]; then
+    echo "debug1: Next authentication method: password" >&2
+fi
+sleep 0.05
+echo "Authenticated to web.example ([10.0.0.1]:22) using \"publickey\"." >&2
+echo "debug1: Entering interactive session." >&2
+echo "remote $*"
+FAKE
+chmod +x "$HOME/ssh"
+export SCC_SSH="$HOME/ssh"
+
+fail() {
+    echo "FAIL: $*"
+    cat "$HOME/.scc/latency" 2>/dev/null
+    exit 1
+}
+
+output=$("$SCC" connect web 2>&1) || fail "scc connect exited with $?"
+[ "$output" = "remote -v -- deploy@web.example" ] || fail "unexpected output: $output"
+# name, when, teardown, spawn, connect, auth, total, multiplexed, prompted
+awk -F '\t' 'NF != 9 || $1 != "web" || $5 < 40 || $6 < 40 || $7 < $5 + $6 || $8 != "-" || $9 != "-" { exit 1 }' \
+    "$HOME/.scc/latency" || fail "bad latency line"
+
+FAKE_PROMPT=1 "$SCC" connect web > /dev/null 2>&1 || fail "scc connect exited with $?"
+[ $(wc -l < "$HOME/.scc/latency") -eq 2 ] || fail "second launch not recorded"
+tail -n 1 "$HOME/.scc/latency" | awk -F '\t' '$9 != "p" { exit 1 }' || fail "password launch not flagged"
+
+# a -v of the user's own is not doubled, and the log they asked for is shown
+output=$(SCC_SSH="$HOME/ssh -v" "$SCC" connect web 2>&1) || fail "scc connect exited with $?"
+echo "$output" | grep -qx "remote -v -- deploy@web.example" || fail "the user's -v was doubled: $output"
+echo "$output" | grep -q "^debug1: Connecting to web.example" || fail "the log asked for was swallowed: $output"
+[ $(wc -l < "$HOME/.scc/latency") -eq 3 ] || fail "launch with the user's -v not recorded"
+
+# with timing off ssh runs as it is, without -v and without a record
+output=$(SCC_NO_TIMING=1 "$SCC" connect web 2>/dev/null) || fail "scc connect exited with $?"
+[ "$output" = "remote -- deploy@web.example" ] || fail "-v added with timing off: $output"
+[ $(wc -l < "$HOME/.scc/latency") -eq 3 ] || fail "launch recorded with timing off"
+
+echo "ok   connect records latency, prompted launches flagged, -v only when timing and never twice"
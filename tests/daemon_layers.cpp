@@ -0,0 +1,149 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+/**
+    With a daemon running, scc takes the shared layers and provider output
+    from its snapshot instead of parsing them again. Whatever it writes
+    must still come from its own writable layer as it is on disk: the
+    snapshot leaves out hidden records and lags the files by up to a poll.
+
+    Starts a daemon on a scratch home where a read-only layer above the
+    writable one hides a local connection, loads through the daemon and
+    edits, imports, removes and undoes, checking the writable file after
+    every write.
+**/
+
+#include "sshdatabase.h"
+#include "daemon.h"
+#include "testing.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sstream>
+
+// the daemon loads on start and picks up provider output on its next poll
+#define TEST_TIMEOUT_MS 10000
+// enough to spread the snapshot over many reads, records split between them
+#define TEST_BULK 20000
+
+static bool hasRecord( const std::string &file, const std::string &name, const std::string &hostname, const std::string &password )
+{
+    return file.find( TestHome::record( name, hostname, "", "me", password ) ) != std::string::npos;
+}
+
+static bool waitForProvider()
+{
+    // fetch until the daemon serves the provider connection as well
+    for ( int waited = 0; waited < TEST_TIMEOUT_MS; waited += 50 ) {
+        std::vector< Connection* > records;
+        bool found = false;
+        if ( DaemonClient::fetch( DAEMON_OP_SNAPSHOT, "", records ) == true ) {
+            for ( std::vector< Connection* >::iterator it = records.begin(); it != records.end(); ++it ) {
+                found = found == true || (*it)->getName() == "inv1";
+                delete (*it);
+            }
+        }
+        if ( found == true ) {
+            return true;
+        }
+        usleep( 50000 );
+    }
+    return false;
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    home.writeFile( ".scc/connections", TestHome::record( "web", "web.local", "", "me", "secret" )
+                                        + TestHome::record( "app", "app.local", "", "me" ) );
+    std::string overrides = TestHome::record( "web", "web.override", "", "ops" ) + TestHome::record( "db", "db.override", "", "ops" );
+    for ( unsigned int i = 0; i < TEST_BULK; i++ ) {
+        std::ostringstream name;
+        name << "bulk" << i;
+        overrides += TestHome::record( name.str(), "bulk.example", "bulk", "ops" );
+    }
+    home.writeFile( ".scc/overrides", overrides );
+    home.writeFile( ".scc/sources", "rw ~/.scc/connections\nro ~/.scc/overrides\n" );
+    home.writeFile( ".scc/providers", "inventory 3600 printf 'inv1\\tinv1.example\\n'\n" );
+
+    // before any thread exists, the daemon gets the process to itself
+    pid_t daemon = fork();
+    if ( daemon == 0 ) {
+        DatabaseDaemon database;
+        _exit( database.run( false ) );
+    }
+
+    int failures = 0;
+    if ( waitForProvider() == false ) {
+        failures += expect( false, "the daemon never served a snapshot" );
+    } else {
+        // only the daemon can still supply the provider connection after this
+        unlink( home.getPath( ".scc/providers" ).c_str() );
+        unlink( home.getPath( ".scc/cache/inventory" ).c_str() );
+
+        SSHDatabase database;
+        database.loadDatabase( true );
+        failures += expect( database.getConnectionByName( "inv1" ) != NULL, "the database was loaded through the daemon" );
+        failures += expect( database.getConnectionByName( "web" ) != NULL && database.getConnectionByName( "web" )->getHostname() == "web.override"
+                            && database.getConnections().size() == 4 + TEST_BULK,
+                            "the snapshot layers hide the local connection as they do on disk" );
+
+        std::string file;
+        database.addConnection( "new", "new.local", "", "me", "" );
+        file = home.readFile( ".scc/connections" );
+        failures += expect( hasRecord( file, "web", "web.local", "secret" ) && hasRecord( file, "app", "app.local", "" )
+                            && hasRecord( file, "new", "new.local", "" ),
+                            "adding keeps the hidden local connection in the writable layer" );
+
+        database.updateConnection( database.getConnectionByName( "app" ), "app", "app2.local", "", "me", "" );
+        file = home.readFile( ".scc/connections" );
+        failures += expect( hasRecord( file, "web", "web.local", "secret" ) && hasRecord( file, "app", "app2.local", "" )
+                            && file.find( "app.local" ) == std::string::npos,
+                            "editing keeps the hidden local connection in the writable layer" );
+
+        std::vector< Connection* > batch;
+        batch.push_back( new Connection( "imported", "imported.local", "", "me", "" ) );
+        batch.push_back( new Connection( "db", "db.local", "", "me", "" ) );
+        unsigned int added = database.addConnections( batch );
+        file = home.readFile( ".scc/connections" );
+        failures += expect( added == 1 && hasRecord( file, "web", "web.local", "secret" ) && hasRecord( file, "imported", "imported.local", "" )
+                            && file.find( "db" ) == std::string::npos,
+                            "importing keeps the hidden local connection and skips names that exist" );
+
+        database.removeConnection( database.getConnectionByName( "new" ) );
+        database.undo();
+        file = home.readFile( ".scc/connections" );
+        failures += expect( hasRecord( file, "web", "web.local", "secret" ) && hasRecord( file, "new", "new.local", "" ),
+                            "remove and undo keep the hidden local connection in the writable layer" );
+        failures += expect( home.readFile( ".scc/overrides" ) == overrides,
+                            "the read-only layer is never written" );
+    }
+
+    kill( daemon, SIGTERM );
+    waitpid( daemon, NULL, 0 );
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+/**
+    The group tree holds every visible connection under its group path,
+    with counts kept up to date on every add and remove. Provider swaps
+    and address refreshes remove whole groups at a time, so removing a
+    member must not depend on how big its group is.
+
+    Builds a small tree to check counts, pruning, moving a connection to
+    another group and the folded lookups, then empties one large group in
+    an order that defeats a linear search.
+**/
+
+#include "sshdatabase.h"
+#include "grouptree.h"
+#include "testing.h"
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
+#include <sstream>
+
+#define TEST_LARGE_GROUP 150000
+// the linear search this replaced took seconds for the large group
+#define TEST_LARGE_LIMIT_MS 1000
+
+static Connection* makeConnection( const std::string &name, const std::string &group )
+{
+    return new Connection( name, name + ".example", group, "user", "" );
+}
+
+static unsigned int collectCount( GroupNode *node )
+{
+    std::vector< Connection* > members;
+    if ( node != NULL ) {
+        node->collect( members );
+    }
+    return members.size();
+}
+
+static unsigned long long getMilliseconds()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int main()
+{
+    int failures = 0;
+    std::vector< Connection* > owned;
+    {
+        GroupTree tree;
+        Connection *eu = makeConnection( "eu", "prod/eu" );
+        Connection *us = makeConnection( "us", "prod/us" );
+        Connection *upper = makeConnection( "upper", "Prod/eu" );
+        Connection *dev = makeConnection( "dev", "dev" );
+        Connection *loose = makeConnection( "loose", "" );
+        owned.push_back( eu );
+        owned.push_back( us );
+        owned.push_back( upper );
+        owned.push_back( dev );
+        owned.push_back( loose );
+        for ( std::vector< Connection* >::iterator it = owned.begin(); it != owned.end(); ++it ) {
+            tree.add( *it );
+        }
+
+        failures += expect( tree.getRoot()->getCount() == 5 && tree.find( "prod" )->getCount() == 2
+                            && tree.find( "prod/eu" )->getCount() == 1 && tree.find( "" ) == tree.getRoot(),
+                            "add counts every connection in its group and all of its parents" );
+        failures += expect( tree.find( "prod/asia" ) == NULL && tree.find( "Prod" ) != NULL && tree.find( "prod" ) != tree.find( "Prod" ),
+                            "find matches exact segments, prod and Prod are two groups" );
+        failures += expect( tree.countFolded( "prod" ) == 3 && tree.countFolded( "PROD/eu" ) == 0 && tree.countFolded( "prod/eu" ) == 2,
+                            "countFolded adds up every group whose folded path matches" );
+        std::vector< Connection* > folded;
+        tree.collectFolded( "prod/eu", folded );
+        std::sort( folded.begin(), folded.end() );
+        std::vector< Connection* > expected;
+        expected.push_back( eu );
+        expected.push_back( upper );
+        std::sort( expected.begin(), expected.end() );
+        failures += expect( folded == expected, "collectFolded returns the members of every matching group" );
+
+        tree.remove( us );
+        failures += expect( tree.find( "prod/us" ) == NULL && tree.find( "prod" )->getCount() == 1 && tree.getRoot()->getCount() == 4,
+                            "remove drops the counts and prunes a group that went empty" );
+        tree.remove( us );
+        failures += expect( tree.getRoot()->getCount() == 4, "removing a connection twice changes nothing" );
+
+        // moving to another group is a remove under the old group and an add under the new one
+        tree.remove( dev );
+        dev->setGroup( "prod/us" );
+        tree.add( dev );
+        failures += expect( tree.find( "dev" ) == NULL && tree.find( "prod/us" )->getCount() == 1
+                            && tree.find( "prod" )->getCount() == 2 && tree.getRoot()->getCount() == 4,
+                            "a connection moved to another group is counted under the new one only" );
+
+        tree.remove( loose );
+        tree.remove( eu );
+        tree.remove( upper );
+        tree.remove( dev );
+        failures += expect( tree.getRoot()->getCount() == 0 && tree.getRoot()->getChildren().empty() == true,
+                            "removing every connection leaves an empty root" );
+    }
+
+    {
+        GroupTree tree;
+        std::vector< Connection* > large;
+        for ( unsigned int i = 0; i < TEST_LARGE_GROUP; i++ ) {
+            std::ostringstream oss;
+            oss << "host" << i;
+            large.push_back( makeConnection( oss.str(), "big" ) );
+            tree.add( large.back() );
+        }
+        owned.insert( owned.end(), large.begin(), large.end() );
+
+        // front to back, the worst order for a search that starts at the front of a vector that shifts
+        unsigned long long start = getMilliseconds();
+        for ( size_t i = 0; i < large.size(); i += 2 ) {
+            tree.remove( large[ i ] );
+        }
+        unsigned int half = collectCount( tree.find( "big" ) );
+        for ( size_t i = 1; i < large.size(); i += 2 ) {
+            tree.remove( large[ i ] );
+        }
+        unsigned long long elapsed = getMilliseconds() - start;
+        failures += expect( half == TEST_LARGE_GROUP / 2 && tree.find( "big" ) == NULL,
+                            "a large group keeps the right members while it empties" );
+        failures += expect( elapsed < TEST_LARGE_LIMIT_MS, "%u removes from one group in %llu ms", TEST_LARGE_GROUP, elapsed );
+    }
+
+    for ( std::vector< Connection* >::iterator it = owned.begin(); it != owned.end(); ++it ) {
+        delete (*it);
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,182 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+
+/**
+    scc --import reads ssh config, known_hosts and CSV/TSV files into
+    connections, counts what it had to skip and commits the rest in one
+    write, leaving out names the database already has.
+
+    Imports a file of each kind with bad and unusual lines in it, checks
+    the skip counts and that no control character makes it into a field,
+    imports a CSV big enough to be parsed in parallel chunks, and commits
+    a batch holding duplicates.
+**/
+
+#include "importer.h"
+#include "sshdatabase.h"
+#include "testing.h"
+#include <stdio.h>
+#include <sstream>
+
+// past the size where the importer splits the file across threads
+#define TEST_BULK_ROWS 60000
+
+static bool isClean( const std::vector< Connection* > &connections )
+{
+    for ( std::vector< Connection* >::const_iterator it = connections.begin(); it != connections.end(); ++it ) {
+        std::string fields = (*it)->getName() + (*it)->getHostname() + (*it)->getGroup() + (*it)->getUser() + (*it)->getPassword();
+        for ( std::string::iterator c = fields.begin(); c != fields.end(); ++c ) {
+            if ( (unsigned char)*c < 0x20 || *c == 0x7f ) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void release( std::vector< Connection* > &connections )
+{
+    for ( std::vector< Connection* >::iterator it = connections.begin(); it != connections.end(); ++it ) {
+        delete (*it);
+    }
+    connections.clear();
+}
+
+static int testFormats( TestHome &home )
+{
+    int failures = 0;
+    home.writeFile( "inventory.csv", std::string( "name,hostname,group,user,password\n" )
+                                     + "web,web.example,prod,deploy,\n"
+                                     + "\"db, primary\",db.example,,\"o\"\"neil\"\n"
+                                     + "evil\x1f" + "name,evil\x01.example,prod\x7f,root\n"
+                                     + "nohost,,prod,root\n"
+                                     + ",nameless.example\n"
+                                     + "# a comment\n" );
+    Importer csv( IMPORT_AUTO, "imported" );
+    bool parsed = csv.parseFile( home.getPath( "inventory.csv" ) );
+    std::vector< Connection* > connections = csv.takeConnections();
+    failures += expect( parsed == true && connections.size() == 3 && csv.getSkipped() == 2,
+                        "csv: 3 rows imported and 2 without a name or hostname skipped, %u and %u",
+                        (unsigned int)connections.size(), csv.getSkipped() );
+    failures += expect( connections.size() == 3 && connections[ 1 ]->getName() == "db, primary" && connections[ 1 ]->getGroup() == "imported"
+                        && connections[ 1 ]->getUser() == "o\"neil",
+                        "csv: quoted fields keep separators and quotes, empty ones get the defaults" );
+    failures += expect( connections.size() == 3 && connections[ 2 ]->getName() == "evil name" && connections[ 2 ]->getHostname() == "evil .example"
+                        && isClean( connections ) == true,
+                        "csv: control characters are replaced like in provider output" );
+    release( connections );
+
+    home.writeFile( "known_hosts", std::string( "web.example,10.0.0.1 ssh-ed25519 AAAA\n" )
+                                   + "@cert-authority *.example ssh-ed25519 AAAA\n"
+                                   + "@revoked bad.example ssh-ed25519 AAAA\n"
+                                   + "|1|c2FsdA==|aGFzaA== ssh-ed25519 AAAA\n"
+                                   + "[alt.example]:2222 ssh-ed25519 AAAA\n"
+                                   + "[std.example]:22 ssh-ed25519 AAAA\n"
+                                   + "*.wild.example ssh-ed25519 AAAA\n"
+                                   + "ctl\x1b.example ssh-ed25519 AAAA\n" );
+    Importer known( IMPORT_AUTO, "known" );
+    parsed = known.parseFile( home.getPath( "known_hosts" ) );
+    connections = known.takeConnections();
+    failures += expect( parsed == true && connections.size() == 3 && known.getSkipped() == 5,
+                        "known_hosts: 3 hosts imported, @ lines, hashes, other ports and wildcards skipped, %u and %u",
+                        (unsigned int)connections.size(), known.getSkipped() );
+    failures += expect( connections.size() == 3 && connections[ 0 ]->getHostname() == "web.example" && connections[ 1 ]->getHostname() == "std.example"
+                        && connections[ 2 ]->getHostname() == "ctl .example",
+                        "known_hosts: the first name of a line is used, control characters replaced" );
+    release( connections );
+
+    home.writeFile( "config", std::string( "Host *\n    User nobody\n" )
+                              + "Host web web-alias\n    HostName web.example\n    User deploy\n"
+                              + "Match host foo\n    User ignored\n"
+                              + "Host = db\n    HostName=db\x1f" + "example\n" );
+    Importer config( IMPORT_AUTO, "config" );
+    parsed = config.parseFile( home.getPath( "config" ) );
+    connections = config.takeConnections();
+    failures += expect( parsed == true && connections.size() == 3 && connections[ 0 ]->getHostname() == "web.example"
+                        && connections[ 1 ]->getName() == "web-alias" && connections[ 1 ]->getUser() == "deploy"
+                        && connections[ 2 ]->getHostname() == "db example" && isClean( connections ) == true,
+                        "ssh config: every alias of a Host block, wildcards left out, control characters replaced" );
+    release( connections );
+    return failures;
+}
+
+static int testCommit( TestHome &home )
+{
+    int failures = 0;
+    std::ostringstream rows;
+    for ( unsigned int i = 0; i < TEST_BULK_ROWS; i++ ) {
+        rows << "host" << i << ",h" << i << ".example,bulk/g" << i % 10 << ",user" << i % 3 << "\n";
+    }
+    // one duplicate against the database, one inside the file
+    rows << "web,other.example,bulk,root\n" << "host7,again.example,bulk,root\n";
+    home.writeFile( "bulk.csv", rows.str() );
+    home.writeFile( ".scc/connections", TestHome::record( "web", "web.example", "prod", "deploy" ) );
+
+    Importer importer( IMPORT_CSV, "bulk" );
+    bool parsed = importer.parseFile( home.getPath( "bulk.csv" ) );
+    std::vector< Connection* > batch = importer.takeConnections();
+    failures += expect( parsed == true && batch.size() == TEST_BULK_ROWS + 2 && importer.getSkipped() == 0
+                        && batch.front()->getName() == "host0" && batch[ TEST_BULK_ROWS - 1 ]->getName() == "host59999",
+                        "a file parsed in chunks comes back whole and in order, %u rows", (unsigned int)batch.size() );
+
+    SSHDatabase database;
+    database.loadDatabase( false );
+    unsigned int added = database.addConnections( batch );
+    failures += expect( added == TEST_BULK_ROWS && batch.empty() == true,
+                        "names already in the database or earlier in the batch are left out, %u added", added );
+    failures += expect( database.getConnectionByName( "web" )->getHostname() == "web.example"
+                        && database.getConnectionByName( "host7" )->getHostname() == "h7.example",
+                        "the first of a name wins" );
+    failures += expect( database.getGroupCount( "bulk" ) == TEST_BULK_ROWS && database.canUndo() == true,
+                        "the batch is one undoable change" );
+
+    std::istringstream lines( home.readFile( ".scc/connections" ) );
+    std::string line;
+    unsigned int written = 0;
+    bool wellFormed = true;
+    while ( std::getline( lines, line ) ) {
+        written++;
+        unsigned int separators = 0;
+        for ( std::string::iterator it = line.begin(); it != line.end(); ++it ) {
+            separators += *it == 0x1f ? 1 : 0;
+        }
+        wellFormed = wellFormed && separators == 4;
+    }
+    failures += expect( written == TEST_BULK_ROWS + 1 && wellFormed == true,
+                        "everything is written in one go, %u records with five fields each", written );
+    database.undo();
+    failures += expect( database.getConnections().size() == 1, "undo takes the whole import back out" );
+    return failures;
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    int failures = testFormats( home );
+    failures += testCommit( home );
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+/**
+    Connections come from layers listed in ~/.scc/sources, a name held by
+    more than one layer shows the one from the highest layer only. Edits
+    to a read-only connection are saved as an override in the writable
+    layer, which only works when nothing above that layer holds the name.
+
+    Loads a read-only layer below the writable one and another above it,
+    checks which connection wins each name, and edits, removes and undoes
+    across them.
+**/
+
+#include "sshdatabase.h"
+#include "testing.h"
+#include <stdio.h>
+
+static unsigned int getLayer( SSHDatabase &database, const std::string &name )
+{
+    Connection *connection = database.getConnectionByName( name );
+    return connection != NULL ? connection->getLayer() : 0;
+}
+
+static unsigned int countVisible( SSHDatabase &database, const std::string &name )
+{
+    std::vector< Connection* > results = database.getConnections();
+    unsigned int count = 0;
+    for ( std::vector< Connection* >::iterator it = results.begin(); it != results.end(); ++it ) {
+        count += (*it)->getName() == name ? 1 : 0;
+    }
+    return count;
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    home.writeFile( ".scc/shared", TestHome::record( "web", "web.shared", "team", "deploy" )
+                                   + TestHome::record( "db", "db.shared", "team", "deploy" )
+                                   + TestHome::record( "wiki", "wiki.shared", "team", "deploy" ) );
+    home.writeFile( ".scc/connections", TestHome::record( "web", "web.local", "mine", "me", "secret" )
+                                        + TestHome::record( "app", "app.local", "mine", "me" ) );
+    home.writeFile( ".scc/overrides", TestHome::record( "db", "db.override", "ops", "root" )
+                                      + TestHome::record( "vault", "vault.override", "ops", "root" ) );
+    home.writeFile( ".scc/sources", "ro ~/.scc/shared\nrw ~/.scc/connections\nro ~/.scc/overrides\n" );
+
+    int failures = 0;
+    {
+        SSHDatabase database;
+        database.loadDatabase( false );
+
+        failures += expect( database.getConnections().size() == 5 && database.getGroupCount( "*" ) == 5,
+                            "every name is visible once, %u connections", (unsigned int)database.getConnections().size() );
+        failures += expect( getLayer( database, "web" ) == 2 && database.getConnectionByName( "web" )->getHostname() == "web.local",
+                            "the writable layer hides the shared layer below it" );
+        failures += expect( getLayer( database, "db" ) == 3 && database.getConnectionByName( "db" )->getHostname() == "db.override",
+                            "the overrides layer hides the shared layer" );
+        failures += expect( getLayer( database, "wiki" ) == 1 && database.getConnectionByName( "nothing" ) == NULL,
+                            "a name only one layer holds comes from that layer" );
+        failures += expect( database.getGroupCount( "team" ) == 1 && database.getGroupCount( "mine" ) == 2 && database.getGroupCount( "ops" ) == 2,
+                            "hidden connections are not counted in their groups" );
+
+        // below the writable layer, the override wins
+        bool saved = database.updateConnection( database.getConnectionByName( "wiki" ), "wiki", "wiki.mine", "team", "me", "" );
+        failures += expect( saved == true && getLayer( database, "wiki" ) == 2 && countVisible( database, "wiki" ) == 1
+                            && database.getConnectionByName( "wiki" )->getHostname() == "wiki.mine"
+                            && home.readFile( ".scc/connections" ).find( "wiki.mine" ) != std::string::npos,
+                            "editing a shared connection saves an override that wins" );
+
+        // above it, the override would stay hidden
+        std::string before = home.readFile( ".scc/connections" );
+        saved = database.updateConnection( database.getConnectionByName( "db" ), "db", "db.mine", "ops", "me", "" );
+        failures += expect( saved == false && database.getConnectionByName( "db" )->getHostname() == "db.override"
+                            && home.readFile( ".scc/connections" ) == before,
+                            "editing a connection from a layer above the writable one is refused" );
+        saved = database.updateConnection( database.getConnectionByName( "app" ), "vault", "app.local", "mine", "me", "" );
+        failures += expect( saved == false && getLayer( database, "app" ) == 2 && home.readFile( ".scc/connections" ) == before,
+                            "renaming to a name a layer above holds is refused" );
+
+        // taking the local one away lets the shared one show through, undo hides it again
+        database.removeConnection( database.getConnectionByName( "web" ) );
+        failures += expect( getLayer( database, "web" ) == 1 && countVisible( database, "web" ) == 1 && database.getGroupCount( "team" ) == 2,
+                            "removing a local connection shows the shared one below it" );
+        database.undo();
+        failures += expect( getLayer( database, "web" ) == 2 && countVisible( database, "web" ) == 1
+                            && database.getConnectionByName( "web" )->getPassword() == "secret",
+                            "undoing the remove hides the shared one again" );
+        failures += expect( home.readFile( ".scc/shared" ).find( "wiki.mine" ) == std::string::npos
+                            && home.readFile( ".scc/overrides" ).find( "db.mine" ) == std::string::npos,
+                            "read-only layers are never written" );
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+
+/**
+    Regex and glob searches are compiled to a case insensitive DFA, or
+    simulated as an NFA when the DFA would grow too large, and kept in a
+    small LRU so a pattern typed back and forth is compiled once.
+
+    Matches a table of patterns against fields, including the anchors and
+    escaped dollars, checks a pattern past the DFA budget gives the same
+    answers by simulation, and checks what the cache hands back.
+**/
+
+#include "pattern.h"
+#include "testing.h"
+#include <stdio.h>
+#include <string>
+
+#define TEST_CACHE_SIZE 2
+// (a|b)*a(a|b){12} needs 2^13 dfa states, past the budget
+#define TEST_BLOWUP_LENGTH 12
+
+struct Case
+{
+    const char *pattern;
+    SearchMode mode;
+    const char *field;
+    bool matches;
+};
+
+static const Case cases[] = {
+    { "web", SEARCH_REGEX, "prod-web-01", true },
+    { "WEB", SEARCH_REGEX, "prod-web-01", true },
+    { "^web", SEARCH_REGEX, "prod-web-01", false },
+    { "^prod", SEARCH_REGEX, "prod-web-01", true },
+    { "01$", SEARCH_REGEX, "prod-web-01", true },
+    { "web$", SEARCH_REGEX, "prod-web-01", false },
+    { "^prod-web-\\d+$", SEARCH_REGEX, "prod-web-01", true },
+    { "^prod-web-\\d+$", SEARCH_REGEX, "prod-web-01x", false },
+    { "db|web", SEARCH_REGEX, "prod-web-01", true },
+    { "(db|cache)-0[12]", SEARCH_REGEX, "prod-web-01", false },
+    { "w{1,2}eb", SEARCH_REGEX, "prod-web-01", true },
+    { "o\\$", SEARCH_REGEX, "cost$", false },
+    { "t\\$", SEARCH_REGEX, "cost$", true },
+    { "t\\$", SEARCH_REGEX, "cost", false },
+    { "t\\\\$", SEARCH_REGEX, "cost\\", true },
+    { "t\\\\$", SEARCH_REGEX, "cost\\x", false },
+    { "web*", SEARCH_GLOB, "web-01", true },
+    { "web*", SEARCH_GLOB, "prod-web-01", false },
+    { "*web*", SEARCH_GLOB, "prod-web-01", true },
+    { "web-0?", SEARCH_GLOB, "WEB-01", true },
+    { "web-0?", SEARCH_GLOB, "web-011", false },
+    { "web-0[!2]", SEARCH_GLOB, "web-01", true },
+    { "web-0[!2]", SEARCH_GLOB, "web-02", false },
+    { "a.b", SEARCH_GLOB, "axb", false },
+    { "a.b", SEARCH_GLOB, "a.b", true }
+};
+
+static std::string makeField( unsigned int bits, unsigned int length )
+{
+    std::string field;
+    for ( unsigned int i = 0; i < length; i++ ) {
+        field += ( bits >> i ) & 1 ? 'a' : 'b';
+    }
+    return field;
+}
+
+int main()
+{
+    int failures = 0;
+    for ( size_t i = 0; i < sizeof( cases ) / sizeof( cases[ 0 ] ); i++ ) {
+        Pattern pattern( cases[ i ].pattern, cases[ i ].mode );
+        failures += expect( pattern.isValid() == true && pattern.matches( cases[ i ].field ) == cases[ i ].matches,
+                            "%-5s %-18s %s %s", cases[ i ].mode == SEARCH_GLOB ? "glob" : "regex",
+                            cases[ i ].pattern, cases[ i ].matches == true ? "matches" : "misses ", cases[ i ].field );
+    }
+    failures += expect( Pattern( "(web", SEARCH_REGEX ).isValid() == false && Pattern( "a{3,1}", SEARCH_REGEX ).isValid() == false,
+                        "broken patterns are invalid" );
+
+    // the answer is whether the 13th byte from the end is an a
+    std::string blowup = "(a|b)*a(a|b){12}$";
+    Pattern simulated( blowup, SEARCH_REGEX );
+    bool agrees = simulated.isValid();
+    for ( unsigned int bits = 0; bits < ( 1 << 14 ) && agrees == true; bits += 7 ) {
+        std::string field = makeField( bits, TEST_BLOWUP_LENGTH + 2 );
+        bool expected = field[ 1 ] == 'a';
+        agrees = simulated.matches( field ) == expected;
+    }
+    failures += expect( agrees == true, "a pattern past the dfa budget still matches, by simulation" );
+
+    PatternCache cache( TEST_CACHE_SIZE );
+    std::shared_ptr< const Pattern > web = cache.get( "web", SEARCH_REGEX );
+    failures += expect( cache.get( "web", SEARCH_REGEX ) == web, "asking again hands back the same pattern" );
+    failures += expect( cache.get( "web", SEARCH_GLOB ) != web, "the mode is part of the key" );
+    cache.get( "db", SEARCH_REGEX );
+    failures += expect( cache.get( "web", SEARCH_REGEX ) != web && web->matches( "web" ) == true,
+                        "the least recently used pattern is evicted, searches still holding it keep it" );
+    std::shared_ptr< const Pattern > db = cache.get( "db", SEARCH_REGEX );
+    cache.get( "web", SEARCH_REGEX );
+    failures += expect( cache.get( "db", SEARCH_REGEX ) == db, "using a pattern keeps it in the cache" );
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+/**
+    Provider output is whatever an inventory command printed, it ends up
+    in the cache, the database and finally in a shell command line.
+
+    Runs a provider over TSV and JSON records with escapes, control
+    characters and shell syntax in them, checks what the fields decode
+    to and that launching them hands ssh the fields as they are, without
+    the shell acting on any of it.
+**/
+
+#include "sshdatabase.h"
+#include "testing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static std::string getField( SSHDatabase &database, const std::string &hostname, bool user )
+{
+    std::vector< Connection* > results = database.getConnections();
+    for ( std::vector< Connection* >::iterator it = results.begin(); it != results.end(); ++it ) {
+        if ( (*it)->getHostname() == hostname ) {
+            return user == true ? (*it)->getUser() : (*it)->getName();
+        }
+    }
+    return "";
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    home.writeFile( "inventory",
+                    "{\"name\": \"rocket-\\ud83d\\ude80\", \"hostname\": \"rocket.example\"}\n"
+                    "{\"name\": \"half-\\ud83d\", \"host\": \"half.example\"}\n"
+                    "{\"name\": \"bell\\u0007tab\\tunit\\u001fend\", \"hostname\": \"control.example\"}\n"
+                    "{\"name\": \"quote\", \"hostname\": \"quote.example\", \"user\": \"o'brien\"}\n"
+                    "evil\th;touch $HOME/pwned\tteam\t$(touch $HOME/pwned2)\n"
+                    "dash\tdash.example\tteam\t-oProxyCommand=touch $HOME/pwned3\n" );
+    home.writeFile( ".scc/providers", "inventory 3600 cat \"$HOME/inventory\"\n" );
+    home.writeFile( "ssh", "#!/bin/sh\nprintf '%s\\n' \"$@\" > \"$HOME/ssh.args\"\n", true );
+    setenv( "SCC_SSH", home.getPath( "ssh" ).c_str(), 1 );
+    unsetenv( "SCC_CONNECT_BY_ADDRESS" );
+
+    int failures = 0;
+    {
+        SSHDatabase database;
+        database.loadDatabase( false );
+        database.waitForUncachedProviders();
+
+        failures += expect( getField( database, "rocket.example", false ) == "rocket-\xf0\x9f\x9a\x80",
+                            "a JSON surrogate pair decodes to one character" );
+        failures += expect( getField( database, "half.example", false ) == "half-\xef\xbf\xbd",
+                            "a lone surrogate decodes to the replacement character" );
+        failures += expect( getField( database, "control.example", false ) == "bell tab unit end",
+                            "control characters never make it into a field" );
+
+        struct Launch
+        {
+            const char *hostname;
+            const char *argument;
+        };
+        static const Launch launches[] = {
+            { "quote.example", "o'brien@quote.example" },
+            { "h;touch $HOME/pwned", "$(touch $HOME/pwned2)@h;touch $HOME/pwned" },
+            { "dash.example", "-oProxyCommand=touch $HOME/pwned3@dash.example" }
+        };
+        for ( size_t i = 0; i < sizeof( launches ) / sizeof( launches[ 0 ] ); i++ ) {
+            std::vector< Connection* > results = database.getConnections();
+            Connection *connection = NULL;
+            for ( std::vector< Connection* >::iterator it = results.begin(); it != results.end(); ++it ) {
+                connection = (*it)->getHostname() == launches[ i ].hostname ? (*it) : connection;
+            }
+            unlink( home.getPath( "ssh.args" ).c_str() );
+            if ( connection != NULL ) {
+                system( connection->getCommand().c_str() );
+            }
+            failures += expect( connection != NULL && home.readFile( "ssh.args" ) == std::string( "--\n" ) + launches[ i ].argument + "\n",
+                                "ssh gets the fields of %s as one literal argument", launches[ i ].hostname );
+        }
+        failures += expect( home.exists( "pwned" ) == false && home.exists( "pwned2" ) == false && home.exists( "pwned3" ) == false,
+                            "nothing in a field was run by the shell" );
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+/**
+    A provider refresh swaps the provider's connections for new ones, the
+    old ones must be freed as soon as no version of the table holds them
+    any more, the daemon refreshes for as long as it runs. A zero TTL must
+    not run the command on every poll either.
+
+    Refreshes a provider with a zero TTL a couple of times, counting the
+    runs of its command in between, and checks that the connections every
+    refresh replaced are gone.
+**/
+
+#include "sshdatabase.h"
+#include "testing.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <memory>
+
+#define TEST_REFRESHES 2
+// a provider command is quick, but only runs every few seconds
+#define TEST_TIMEOUT_MS 15000
+// polls well inside the minimum interval, none of them may run the command
+#define TEST_FAST_POLLS 100
+
+static void watchProvider( SSHDatabase &database, std::vector< std::weak_ptr< Connection > > &watched )
+{
+    ConnectionTable snapshot = database.getSnapshot();
+    for ( ConnectionTable::const_iterator it = snapshot.begin(); it != snapshot.end(); ++it ) {
+        if ( (*it)->getSource() == "inventory" ) {
+            watched.push_back( snapshot.get( (*it)->getId() ) );
+        }
+    }
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    home.writeFile( ".scc/connections", TestHome::record( "local", "local.example", "", "user" ) );
+    home.writeFile( ".scc/providers", "inventory 0 echo run >> \"$HOME/runs\"; printf 'web1\\tweb1.example\\nweb2\\tweb2.example\\n'\n" );
+
+    int failures = 0;
+    {
+        SSHDatabase database;
+        database.loadDatabase( false );
+        database.waitForUncachedProviders();
+
+        for ( int poll = 0; poll < TEST_FAST_POLLS; poll++ ) {
+            database.pollProviders();
+            usleep( 1000 );
+        }
+        failures += expect( home.readFile( "runs" ) == "run\n", "a zero ttl does not run the command on every poll" );
+
+        std::vector< std::weak_ptr< Connection > > replaced;
+        for ( int refresh = 0; refresh < TEST_REFRESHES && failures == 0; refresh++ ) {
+            std::vector< std::weak_ptr< Connection > > watched;
+            watchProvider( database, watched );
+            if ( watched.size() != 2 ) {
+                failures += expect( false, "refresh %d has %u provider connections", refresh, (unsigned int)watched.size() );
+                break;
+            }
+            replaced.insert( replaced.end(), watched.begin(), watched.end() );
+            int waited = 0;
+            while ( database.pollProviders() == false && waited < TEST_TIMEOUT_MS ) {
+                usleep( 10000 );
+                waited += 10;
+            }
+            if ( waited >= TEST_TIMEOUT_MS ) {
+                failures += expect( false, "refresh %d never finished", refresh );
+            }
+        }
+
+        unsigned int alive = 0;
+        for ( std::vector< std::weak_ptr< Connection > >::iterator it = replaced.begin(); it != replaced.end(); ++it ) {
+            alive += it->expired() == true ? 0 : 1;
+        }
+        failures += expect( alive == 0 && failures == 0, "%u replaced provider connections, %u still alive",
+                            (unsigned int)replaced.size(), alive );
+    }
+    return failures > 0 ? 1 : 0;
+}
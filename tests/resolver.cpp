@@ -0,0 +1,195 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+
+/**
+    Hostnames are resolved ahead of time and kept in ~/.scc/resolved for
+    an hour, a failed lookup for five minutes. The address is searchable
+    as ip: and, with SCC_CONNECT_BY_ADDRESS set, ssh is pointed at it.
+
+    Checks the cache file is read and written with those expiries, that
+    an answer reaches the connections in one batch off the caller's
+    thread, and that undo brings a connection back with the address it
+    has now rather than the one it had when the edit was made.
+**/
+
+#include "sshdatabase.h"
+#include "resolver.h"
+#include "testing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <mutex>
+#include <sstream>
+
+#define TEST_TIMEOUT_MS 10000
+#define TEST_TTL 3600
+
+struct Answers
+{
+    std::mutex mutex;
+    std::vector< std::pair< std::string, std::string > > resolved;
+    unsigned int batches;
+};
+
+static void onResolved( const std::vector< std::pair< std::string, std::string > > &resolved, void *context )
+{
+    Answers *answers = (Answers*)context;
+    std::lock_guard< std::mutex > lock( answers->mutex );
+    answers->resolved.insert( answers->resolved.end(), resolved.begin(), resolved.end() );
+    answers->batches++;
+}
+
+static std::string cacheLine( const std::string &hostname, const std::string &address, long offset )
+{
+    std::ostringstream oss;
+    oss << hostname << '\t' << address << '\t' << time( NULL ) + offset << '\n';
+    return oss.str();
+}
+
+static bool isLoopback( const std::string &address )
+{
+    return address == "127.0.0.1" || address == "::1";
+}
+
+static int testCache( TestHome &home )
+{
+    int failures = 0;
+    home.writeFile( ".scc/resolved", cacheLine( "web.example", "10.1.2.3", 1000 )
+                                     + cacheLine( "old.example", "10.9.9.9", -10 )
+                                     + cacheLine( "gone.example", "", 100 ) );
+    Answers answers;
+    answers.batches = 0;
+    Resolver resolver;
+    resolver.setResolvedHandler( &onResolved, &answers );
+    resolver.loadCache();
+
+    std::string address;
+    bool fresh = resolver.lookup( "web.example", address );
+    failures += expect( fresh == true && address == "10.1.2.3", "a cached address is fresh until it expires" );
+    fresh = resolver.lookup( "old.example", address );
+    failures += expect( fresh == false && address == "10.9.9.9", "an expired address is still handed out, but not fresh" );
+    fresh = resolver.lookup( "gone.example", address );
+    failures += expect( fresh == true && address.empty() == true, "a failed lookup is cached as an empty address" );
+    fresh = resolver.lookup( "new.example", address );
+    failures += expect( fresh == false && address.empty() == true, "an unknown hostname has no address" );
+
+    std::vector< std::string > hostnames;
+    hostnames.push_back( "localhost" );
+    hostnames.push_back( "localhost" );
+    resolver.enqueue( hostnames );
+    for ( unsigned int waited = 0; waited < TEST_TIMEOUT_MS && resolver.isResolving() == true; waited += 10 ) {
+        usleep( 10000 );
+    }
+    {
+        std::lock_guard< std::mutex > lock( answers.mutex );
+        failures += expect( answers.resolved.size() == 1 && answers.resolved[ 0 ].first == "localhost" && isLoopback( answers.resolved[ 0 ].second ) == true,
+                            "a hostname queued twice is looked up once and handed out, %u answers", (unsigned int)answers.resolved.size() );
+    }
+    fresh = resolver.lookup( "localhost", address );
+    failures += expect( fresh == true && isLoopback( address ) == true, "the answer is in the cache" );
+    resolver.stop();
+
+    // the file holds what is still fresh, a new lookup for an hour
+    std::istringstream lines( home.readFile( ".scc/resolved" ) );
+    std::string line;
+    bool localhost = false;
+    bool expired = false;
+    while ( std::getline( lines, line ) ) {
+        std::istringstream fields( line );
+        std::string hostname;
+        std::string cached;
+        long expires = 0;
+        if ( std::getline( fields, hostname, '\t' ) && std::getline( fields, cached, '\t' ) && ( fields >> expires ) ) {
+            long ttl = expires - (long)time( NULL );
+            localhost = localhost || ( hostname == "localhost" && ttl > TEST_TTL - 60 && ttl <= TEST_TTL );
+            expired = expired || hostname == "old.example";
+        }
+    }
+    failures += expect( localhost == true && expired == false, "the saved cache keeps the answer for an hour and drops what expired" );
+    return failures;
+}
+
+static int testDatabase( TestHome &home )
+{
+    int failures = 0;
+    home.writeFile( ".scc/resolved", cacheLine( "web.example", "10.1.2.3", 1000 ) );
+    home.writeFile( ".scc/connections", TestHome::record( "web", "web.example", "prod", "deploy" )
+                                        + TestHome::record( "local", "localhost", "dev", "me" ) );
+
+    SSHDatabase database;
+    database.loadDatabase( false );
+
+    std::vector< Connection* > results = database.queryConnections( "ip:10.1.2.3" );
+    failures += expect( results.size() == 1 && results[ 0 ]->getName() == "web", "ip: finds the connection by its cached address" );
+
+    Connection *web = database.getConnectionByName( "web" );
+    unsetenv( "SCC_CONNECT_BY_ADDRESS" );
+    failures += expect( web != NULL && web->getCommand().find( "-- 'deploy@web.example'" ) != std::string::npos,
+                        "ssh gets the hostname by default" );
+    setenv( "SCC_CONNECT_BY_ADDRESS", "1", 1 );
+    failures += expect( web != NULL && web->getCommand().find( "-o 'HostKeyAlias=web.example' -- 'deploy@10.1.2.3'" ) != std::string::npos,
+                        "SCC_CONNECT_BY_ADDRESS connects to the address and keeps known_hosts keyed by hostname" );
+    unsetenv( "SCC_CONNECT_BY_ADDRESS" );
+
+    // recorded before the address is known, the batch window leaves time for it
+    Connection *local = database.getConnectionByName( "local" );
+    bool saved = database.updateConnection( local, "local", "localhost", "dev", "root", "" );
+
+    // the lookup runs in the background, the event loop only hears about it
+    bool polled = false;
+    for ( unsigned int waited = 0; waited < TEST_TIMEOUT_MS && polled == false; waited += 10 ) {
+        polled = database.pollResolver();
+        usleep( 10000 );
+    }
+    local = database.getConnectionByName( "local" );
+    failures += expect( saved == true && polled == true && local != NULL && local->getUser() == "root" && isLoopback( local->getAddress() ) == true,
+                        "a resolved address is published without polling the table" );
+    results = database.queryConnections( "ip:" + local->getAddress() );
+    failures += expect( results.size() == 1 && results[ 0 ]->getName() == "local", "ip: finds the resolved address" );
+
+    // the history holds the connection as it was before the answer came in
+    database.undo();
+    local = database.getConnectionByName( "local" );
+    failures += expect( local != NULL && local->getUser() == "me" && isLoopback( local->getAddress() ) == true,
+                        "undo brings the connection back with its current address" );
+    database.redo();
+    local = database.getConnectionByName( "local" );
+    failures += expect( local != NULL && local->getUser() == "root" && isLoopback( local->getAddress() ) == true,
+                        "so does redo" );
+    database.undo();
+    failures += expect( database.canUndo() == false, "publishing addresses is not an undoable edit" );
+    return failures;
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    int failures = testCache( home );
+    failures += testDatabase( home );
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+/**
+    Searching must not allocate once the result buffer has grown, typing
+    into the search box runs one search per key on every connection.
+
+    Loads 300k generated connections from a scratch $HOME, warms every
+    kind of search up once and then counts calls to malloc over repeated
+    searches, which operator new goes through as well. Only the searching
+    thread counts, the resolver works through the hostnames meanwhile.
+**/
+
+#include "sshdatabase.h"
+#include "testing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <sstream>
+
+#define TEST_CONNECTIONS 300000
+#define TEST_REPEATS 5
+
+extern "C" void *__libc_malloc( size_t size );
+
+static std::atomic< long > allocations( 0 );
+static thread_local bool counting = false;
+
+extern "C" void *malloc( size_t size )
+{
+    if ( counting == true ) {
+        allocations++;
+    }
+    return __libc_malloc( size );
+}
+
+static std::string makeConnections()
+{
+    std::ostringstream oss;
+    for ( unsigned int i = 0; i < TEST_CONNECTIONS; i++ ) {
+        oss << "host" << i << char(0x1f) << "h" << i << ".example" << char(0x1f)
+            << "g" << i % 7 << "/sub" << i % 3 << char(0x1f) << "user" << i % 5 << char(0x1f) << '\n';
+    }
+    return oss.str();
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false || home.writeFile( ".scc/connections", makeConnections() ) == false ) {
+        return 1;
+    }
+
+    int failures = 0;
+    {
+        SSHDatabase database;
+        database.loadDatabase( false );
+
+        struct Search
+        {
+            const char *text;
+            SearchMode mode;
+        };
+        static const Search searches[] = {
+            { "host1", SEARCH_TEXT },
+            { "HOST12", SEARCH_TEXT },
+            { "name:host1* group:g1", SEARCH_TEXT },
+            { "group:g2/sub1 user:user3", SEARCH_TEXT },
+            { "", SEARCH_TEXT },
+            { "host.*1$", SEARCH_REGEX },
+            { "h*7.example", SEARCH_GLOB }
+        };
+        std::vector< Connection* > results;
+        ConnectionTable version;
+        for ( size_t i = 0; i < sizeof( searches ) / sizeof( searches[ 0 ] ); i++ ) {
+            // the first round grows the buffer and fills the caches
+            database.search( searches[ i ].text, searches[ i ].mode, results, version );
+            allocations = 0;
+            counting = true;
+            for ( int repeat = 0; repeat < TEST_REPEATS; repeat++ ) {
+                database.search( searches[ i ].text, searches[ i ].mode, results, version );
+            }
+            counting = false;
+            failures += expect( allocations == 0 && results.empty() == false, "%-28s %7u results %ld allocations",
+                                searches[ i ].text, (unsigned int)results.size(), (long)allocations );
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
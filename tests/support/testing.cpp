@@ -0,0 +1,116 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#include "testing.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <fstream>
+#include <sstream>
+
+static int removeEntry( const char *path, const struct stat *st, int flag, struct FTW *ftw )
+{
+    return remove( path );
+}
+
+/** BEGIN TESTHOME **/
+
+TestHome::TestHome()
+{
+    char scratch[] = "/tmp/scc-test-XXXXXX";
+    if ( mkdtemp( scratch ) == NULL ) {
+        fprintf( stderr, "unable to create a scratch home\n" );
+        return;
+    }
+    path = scratch;
+    mkdir( ( path + "/.scc" ).c_str(), 0700 );
+    setenv( "HOME", path.c_str(), 1 );
+}
+
+TestHome::~TestHome()
+{
+    // depth first, so every directory is empty by the time it is removed
+    if ( path.empty() == false ) {
+        nftw( path.c_str(), &removeEntry, 16, FTW_DEPTH | FTW_PHYS );
+    }
+}
+
+bool TestHome::isValid() const
+{
+    return path.empty() == false;
+}
+
+const std::string& TestHome::getPath() const
+{
+    return path;
+}
+
+std::string TestHome::getPath( const std::string &name ) const
+{
+    return path + "/" + name;
+}
+
+bool TestHome::writeFile( const std::string &name, const std::string &content, bool executable ) const
+{
+    std::string target = getPath( name );
+    std::ofstream ofs( target.c_str(), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc );
+    ofs << content;
+    ofs.close();
+    if ( executable == true ) {
+        chmod( target.c_str(), 0755 );
+    }
+    return ofs.fail() == false;
+}
+
+std::string TestHome::readFile( const std::string &name ) const
+{
+    std::ifstream ifs( getPath( name ).c_str(), std::ifstream::in | std::ifstream::binary );
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+bool TestHome::exists( const std::string &name ) const
+{
+    return access( getPath( name ).c_str(), F_OK ) == 0;
+}
+
+std::string TestHome::record( const std::string &name, const std::string &hostname, const std::string &group, const std::string &user, const std::string &password )
+{
+    return name + char(0x1f) + hostname + char(0x1f) + group + char(0x1f) + user + char(0x1f) + password + '\n';
+}
+
+/** END TESTHOME **/
+
+int expect( bool passed, const char *format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    printf( "%s ", passed == true ? "ok  " : "FAIL" );
+    vprintf( format, args );
+    printf( "\n" );
+    va_end( args );
+    return passed == true ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+#ifndef __TESTING__H_
+#define __TESTING__H_
+
+#include <string>
+
+/**
+    A scratch $HOME for one test, with an empty ~/.scc in it. HOME points
+    at it for as long as it lives, it is removed with everything in it
+    on the way out.
+
+    Paths handed to the file helpers are relative to the home directory.
+**/
+class TestHome
+{
+public:
+    TestHome();
+    ~TestHome();
+
+    bool isValid() const;
+    const std::string& getPath() const;
+    std::string getPath( const std::string &name ) const;
+    bool writeFile( const std::string &name, const std::string &content, bool executable = false ) const;
+    std::string readFile( const std::string &name ) const;
+    bool exists( const std::string &name ) const;
+
+    // one line of a connections file, fields separated by 0x1f
+    static std::string record( const std::string &name, const std::string &hostname, const std::string &group, const std::string &user, const std::string &password = "" );
+
+private:
+    std::string path;
+};
+
+// prints the outcome as "ok" or "FAIL" followed by the message, returns 1 on failure
+int expect( bool passed, const char *format, ... ) __attribute__(( format( printf, 2, 3 ) ));
+
+#endif
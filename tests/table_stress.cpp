@@ -0,0 +1,147 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+/**
+    Readers scan whatever version is published without taking the lock
+    while a single writer keeps replacing it. A version, once published,
+    must never change under a reader.
+
+    A shared read-only layer holds connections that the writable layer
+    above it keeps hiding and showing again, by adding, removing, undoing
+    and redoing local connections of the same names. Every reader checks
+    that each of those names is visible exactly once in every version it
+    scans, which fails as soon as a writer flips the visibility of a
+    connection that is already published.
+**/
+
+#include "sshdatabase.h"
+#include "testing.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <unordered_map>
+
+#define TEST_SHARED 200
+#define TEST_LOCAL 2000
+#define TEST_READERS 4
+#define TEST_WRITES 400
+
+static std::atomic< bool > writing( true );
+static std::atomic< unsigned long long > scans( 0 );
+static std::atomic< unsigned long long > broken( 0 );
+
+static std::string sharedName( unsigned int i )
+{
+    std::ostringstream oss;
+    oss << "shared" << i;
+    return oss.str();
+}
+
+static void read( SSHDatabase *database )
+{
+    std::vector< Connection* > results;
+    ConnectionTable version;
+    std::unordered_map< std::string, unsigned int > seen;
+    while ( writing == true ) {
+        database->getConnections( std::string_view(), SEARCH_TEXT, results, version );
+        seen.clear();
+        for ( std::vector< Connection* >::iterator it = results.begin(); it != results.end(); ++it ) {
+            if ( (*it)->getName().compare( 0, 6, "shared" ) == 0 ) {
+                seen[ (*it)->getName() ]++;
+            }
+        }
+        // the same version again, a second look must see the same thing
+        unsigned int visible = 0;
+        for ( ConnectionTable::const_iterator it = version.begin(); it != version.end(); ++it ) {
+            visible += (*it)->isShadowed() == false ? 1 : 0;
+        }
+        bool consistent = seen.size() == TEST_SHARED && visible == results.size();
+        for ( std::unordered_map< std::string, unsigned int >::iterator it = seen.begin(); it != seen.end(); ++it ) {
+            consistent = consistent == true && it->second == 1;
+        }
+        broken += consistent == true ? 0 : 1;
+        scans++;
+    }
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    std::string shared;
+    for ( unsigned int i = 0; i < TEST_SHARED; i++ ) {
+        shared += TestHome::record( sharedName( i ), sharedName( i ) + ".example", "team", "deploy" );
+    }
+    std::string local;
+    for ( unsigned int i = 0; i < TEST_LOCAL; i++ ) {
+        std::ostringstream oss;
+        oss << "local" << i;
+        local += TestHome::record( oss.str(), oss.str() + ".example", "mine", "me" );
+    }
+    home.writeFile( ".scc/shared", shared );
+    home.writeFile( ".scc/connections", local );
+    home.writeFile( ".scc/sources", "ro ~/.scc/shared\nrw ~/.scc/connections\n" );
+
+    int failures = 0;
+    {
+        SSHDatabase database;
+        database.loadDatabase( false );
+
+        std::vector< std::thread > readers;
+        for ( unsigned int i = 0; i < TEST_READERS; i++ ) {
+            readers.push_back( std::thread( &read, &database ) );
+        }
+
+        // every step hides or shows one shared connection
+        for ( unsigned int i = 0; i < TEST_WRITES; i++ ) {
+            std::string name = sharedName( ( i / 4 ) % TEST_SHARED );
+            switch ( i % 4 ) {
+            case 0:
+                database.addConnection( name, "override.example", "mine", "me", "" );
+                break;
+            case 1:
+                database.removeConnection( database.getConnectionByName( name ) );
+                break;
+            case 2:
+                database.undo();
+                break;
+            case 3:
+                database.redo();
+                break;
+            }
+        }
+        writing = false;
+        for ( std::vector< std::thread >::iterator it = readers.begin(); it != readers.end(); ++it ) {
+            it->join();
+        }
+
+        std::vector< Connection* > results = database.getConnections();
+        failures += expect( results.size() == TEST_SHARED + TEST_LOCAL, "%u connections visible after the writes", (unsigned int)results.size() );
+        failures += expect( broken == 0 && scans > 0, "%llu scans during %u writes, %llu saw a version change under them",
+                            (unsigned long long)scans, TEST_WRITES, (unsigned long long)broken );
+    }
+    return failures > 0 ? 1 : 0;
+}
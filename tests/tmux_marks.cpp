@@ -0,0 +1,140 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+/**
+    Marked connections are opened in tmux by what was marked, not by
+    name: two connections called "web" are two marks and two sessions.
+
+    Drives the window headless, marks both of them and launches through
+    a stand-in tmux given as $SCC_TMUX, which writes down its arguments.
+    It splits them into commands the way tmux does, a trailing ; ends
+    one, and runs every window and pane command through sh against a
+    stand-in ssh. A third connection has a name ending in ; and shell
+    in its hostname, neither may reach tmux or the shell as such.
+**/
+
+#include "resources.h"
+#include "headlessrenderer.h"
+#include "testing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fstream>
+
+// what tmux makes of its arguments, as far as this test needs it
+#define TEST_TMUX "#!/bin/sh\n" \
+    "printf '%s\\n' \"$@\" > \"$HOME/tmux.args\"\n" \
+    "run() { case \"$1\" in new-session|new-window|split-window) sh -c \"$2\" ;; esac; }\n" \
+    "first=; last=\n" \
+    "for arg in \"$@\"; do\n" \
+    "    case \"$arg\" in\n" \
+    "    ';') run \"$first\" \"$last\"; first=; last=; continue ;;\n" \
+    "    *'\\;') arg=\"${arg%??};\" ;;\n" \
+    "    *';') [ -z \"$first\" ] && first=${arg%?}; run \"$first\" \"${arg%?}\"; first=; last=; continue ;;\n" \
+    "    esac\n" \
+    "    [ -z \"$first\" ] && first=$arg\n" \
+    "    last=$arg\n" \
+    "done\n" \
+    "run \"$first\" \"$last\"\n"
+#define TEST_SSH "#!/bin/sh\nprintf '%s\\n' \"$@\" >> \"$HOME/ssh.args\"\n"
+#define TEST_EVIL_HOST "web-c.example;touch $HOME/pwned"
+
+static void press( Window &window, HeadlessRenderer &renderer, int c, bool text )
+{
+    renderer.pushInput( c, text );
+    window.drawFrame();
+}
+
+static unsigned int countArguments( const std::string &path, const std::string &text )
+{
+    std::ifstream ifs( path.c_str() );
+    std::string line;
+    unsigned int count = 0;
+    while ( std::getline( ifs, line ) ) {
+        count += line.find( text ) != std::string::npos ? 1 : 0;
+    }
+    return count;
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    home.writeFile( ".scc/connections", TestHome::record( "web", "web-a.example", "", "deploy" )
+                                        + TestHome::record( "web", "web-b.example", "", "deploy" )
+                                        + TestHome::record( "db", "db.example", "", "deploy" ) );
+    home.writeFile( "tmux", TEST_TMUX, true );
+    home.writeFile( "ssh", TEST_SSH, true );
+    setenv( "SCC_TMUX", home.getPath( "tmux" ).c_str(), 1 );
+    setenv( "SCC_SSH", home.getPath( "ssh" ).c_str(), 1 );
+    unsetenv( "TMUX" );
+
+    Resources::Instance()->getSSHDatabase()->waitForLoad();
+    std::string arguments = home.getPath( "tmux.args" );
+    std::string sshArguments = home.getPath( "ssh.args" );
+    int failures = 0;
+    HeadlessRenderer *renderer = new HeadlessRenderer( 24, 80 );
+    {
+        Window window( renderer );
+        window.init();
+        window.drawFrame();
+        press( window, *renderer, 'w', true );
+        press( window, *renderer, 'e', true );
+        press( window, *renderer, 'b', true );
+        // every mark moves the selection down, so this marks both of them
+        press( window, *renderer, K_CTRL_T, false );
+        press( window, *renderer, K_CTRL_T, false );
+        press( window, *renderer, K_CTRL_O, false );
+
+        unsigned int first = countArguments( arguments, "deploy@web-a.example" );
+        unsigned int second = countArguments( arguments, "deploy@web-b.example" );
+        unsigned int other = countArguments( arguments, "deploy@db.example" );
+        failures += expect( first == 1 && second == 1 && other == 0, "launched web-a %u, web-b %u and db %u times", first, second, other );
+        failures += expect( countArguments( sshArguments, "deploy@web-" ) == 2, "ssh ran in both windows" );
+
+        // a name tmux would cut a command short at, and shell in a hostname
+        Resources::Instance()->getSSHDatabase()->addConnection( "web;", TEST_EVIL_HOST, "", "deploy", "" );
+        window.drawFrame();
+        unlink( sshArguments.c_str() );
+        press( window, *renderer, K_CTRL_A, false );
+        press( window, *renderer, K_CTRL_O, false );
+        failures += expect( countArguments( arguments, "web\\;" ) == 1 && countArguments( sshArguments, "deploy@web-" ) == 3,
+                            "a window name ending in ; goes to tmux escaped, every window still starts" );
+        unlink( sshArguments.c_str() );
+        press( window, *renderer, K_CTRL_A, false );
+        press( window, *renderer, K_CTRL_P, false );
+        failures += expect( countArguments( sshArguments, "deploy@web-" ) == 3, "and every pane" );
+    }
+    Resources::DestroyInstance();
+
+    std::ifstream ifs( sshArguments.c_str() );
+    std::string line;
+    bool literal = false;
+    while ( std::getline( ifs, line ) ) {
+        literal = literal || line == "deploy@" TEST_EVIL_HOST;
+    }
+    failures += expect( literal == true && home.exists( "pwned" ) == false,
+                        "ssh gets %s as one literal argument, the shell runs none of it", TEST_EVIL_HOST );
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+
+/**
+    Every add, edit and delete can be undone and redone, the history is
+    kept for the last 256 changes and a new edit drops what could still
+    be redone. Undo and redo write the file like any other edit.
+
+    Walks one connection through add, edit and delete and back, checks a
+    new edit clears redo, then fills the history past its cap.
+**/
+
+#include "sshdatabase.h"
+#include "testing.h"
+#include <stdio.h>
+#include <sstream>
+
+// MAX_HISTORY in sshdatabase.cpp
+#define TEST_HISTORY 256
+#define TEST_EXTRA 10
+
+static std::string hostnameOf( SSHDatabase &database, const std::string &name )
+{
+    Connection *connection = database.getConnectionByName( name );
+    return connection != NULL ? connection->getHostname() : "";
+}
+
+static bool isSaved( TestHome &home, const std::string &hostname )
+{
+    return home.readFile( ".scc/connections" ).find( hostname ) != std::string::npos;
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+
+    int failures = 0;
+    SSHDatabase database;
+    database.loadDatabase( false );
+    failures += expect( database.canUndo() == false && database.canRedo() == false && database.undo() == false && database.redo() == false,
+                        "an empty history has nothing to undo or redo" );
+
+    database.addConnection( "web", "web.example", "prod", "deploy", "" );
+    database.updateConnection( database.getConnectionByName( "web" ), "web", "web2.example", "prod", "deploy", "" );
+    database.removeConnection( database.getConnectionByName( "web" ) );
+    failures += expect( database.getConnectionByName( "web" ) == NULL && isSaved( home, "web" ) == false, "add, edit and delete" );
+
+    database.undo();
+    failures += expect( hostnameOf( database, "web" ) == "web2.example" && isSaved( home, "web2.example" ) == true,
+                        "undoing the delete brings back the edited connection and saves it" );
+    database.undo();
+    failures += expect( hostnameOf( database, "web" ) == "web.example" && isSaved( home, "web.example" ) == true,
+                        "undoing the edit brings back the original" );
+    database.undo();
+    failures += expect( database.getConnectionByName( "web" ) == NULL && database.canUndo() == false && isSaved( home, "web" ) == false,
+                        "undoing the add empties the database" );
+
+    database.redo();
+    failures += expect( hostnameOf( database, "web" ) == "web.example", "redo adds it again" );
+    database.redo();
+    failures += expect( hostnameOf( database, "web" ) == "web2.example" && database.canRedo() == true, "redo edits it again" );
+
+    // a new edit forks the history, the delete can no longer be redone
+    database.updateConnection( database.getConnectionByName( "web" ), "web", "web3.example", "prod", "deploy", "" );
+    failures += expect( database.canRedo() == false && database.redo() == false && hostnameOf( database, "web" ) == "web3.example",
+                        "a new edit clears redo" );
+    database.undo();
+    failures += expect( hostnameOf( database, "web" ) == "web2.example" && database.canRedo() == true, "and can itself be undone" );
+    database.redo();
+
+    // two changes are in the history, fill it past the cap
+    for ( unsigned int i = 0; i < TEST_HISTORY + TEST_EXTRA; i++ ) {
+        std::ostringstream name;
+        name << "host" << i;
+        database.addConnection( name.str(), name.str() + ".example", "bulk", "deploy", "" );
+    }
+    unsigned int undone = 0;
+    while ( database.undo() == true ) {
+        undone++;
+    }
+    failures += expect( undone == TEST_HISTORY, "only the last %u changes can be undone, %u were", TEST_HISTORY, undone );
+    failures += expect( database.getGroupCount( "bulk" ) == TEST_EXTRA && database.getConnectionByName( "host9" ) != NULL
+                        && database.getConnectionByName( "host10" ) == NULL && hostnameOf( database, "web" ) == "web3.example",
+                        "what fell off the history stays as it is" );
+    unsigned int redone = 0;
+    while ( database.redo() == true ) {
+        redone++;
+    }
+    failures += expect( redone == TEST_HISTORY && database.getGroupCount( "bulk" ) == TEST_HISTORY + TEST_EXTRA,
+                        "all of it can be redone" );
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+
+/**
+    Searches compare folded text, so case, accents written either way and
+    fullwidth letters all match. Drawing measures text in terminal columns.
+    Neither may depend on the locale scc happens to run in.
+
+    Runs in the C locale, which is what a process has before setlocale(),
+    then once more after switching to whatever the environment names.
+**/
+
+#include "unicode.h"
+#include "testing.h"
+#include <stdio.h>
+#include <locale.h>
+
+static std::string fold( std::string_view text )
+{
+    std::string out;
+    Unicode::fold( text, out );
+    return out;
+}
+
+static int check( const char *locale )
+{
+    int failures = 0;
+    // precomposed, decomposed and upper case e acute
+    std::string cafe = fold( "café" );
+    failures += expect( cafe == fold( "cafe\xcc\x81" ) && cafe == fold( "CAFÉ" ) && cafe == fold( "CAFE\xcc\x81" ),
+                        "%s: accents fold the same written either way and in either case", locale );
+    failures += expect( cafe.compare( 0, 4, "cafe" ) == 0, "%s: the base letter comes first, a plain search finds it", locale );
+    failures += expect( fold( "ＷＥＢ－０１" ) == "web-01", "%s: fullwidth forms fold to ascii", locale );
+    failures += expect( fold( "ΣΊΣΥΦΟΣ" ) == fold( "σίσυφος" ), "%s: greek, final sigma included", locale );
+    failures += expect( fold( std::string( "a\xff" "b", 3 ) ) == std::string( "a\xff" "b", 3 ), "%s: invalid bytes pass through", locale );
+
+    failures += expect( Unicode::width( "web-01" ) == 6 && Unicode::width( "café" ) == 4, "%s: narrow text", locale );
+    failures += expect( Unicode::width( "cafe\xcc\x81" ) == 4 && Unicode::next( "e\xcc\x81x", 0 ) == 3,
+                        "%s: a combining mark takes no column and stays with its letter", locale );
+    failures += expect( Unicode::width( "日本" ) == 4 && Unicode::width( "ｗ" ) == 2, "%s: wide characters take two columns, %u",
+                        locale, (unsigned int)Unicode::width( "日本" ) );
+    failures += expect( Unicode::fit( "日本", 3 ) == 3 && Unicode::fit( "日本", 4 ) == 6 && Unicode::fit( "a日", 2 ) == 1,
+                        "%s: fit never splits a wide character", locale );
+    failures += expect( Unicode::width( "\x01\xff" ) == 2, "%s: control characters and invalid bytes take a column each", locale );
+
+    std::string typed = "caf";
+    Unicode::append( typed, 0xe9 );
+    failures += expect( typed == "café", "%s: append encodes a code point", locale );
+    Unicode::popBack( typed );
+    failures += expect( typed == "caf", "%s: popBack removes a whole character", locale );
+    return failures;
+}
+
+int main()
+{
+    int failures = check( "C" );
+    const char *locale = setlocale( LC_ALL, "" );
+    failures += check( locale != NULL ? locale : "C" );
+    return failures > 0 ? 1 : 0;
+}
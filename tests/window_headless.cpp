@@ -0,0 +1,132 @@
+/**
+    Copyright (C) 2020-2021 sshconcli
+
+    Written by Tobias Eliasson <arnestig@gmail.com>.
+
+    This file is part of sshconcli <https://github.com/arnestig/sshconcli>.
+
+    sshconcli is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    sshconcli is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with sshconcli.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+
+
+
+/**
+    Window draws through a Renderer, the headless one keeps the screen in
+    memory and counts what a terminal would have been sent. A key shows
+    on the frame after the one that read it.
+
+    Draws a database of 100 connections on a 20x80 screen, checks the
+    text of the first frame, moves the selection to the bottom of the
+    list and takes one more step down, which has to scroll the rows up
+    rather than repaint them.
+**/
+
+#include "window.h"
+#include "headlessrenderer.h"
+#include "resources.h"
+#include "sshdatabase.h"
+#include "testing.h"
+#include <stdio.h>
+#include <sstream>
+
+#define TEST_ROWS 20
+#define TEST_COLUMNS 80
+#define TEST_CONNECTIONS 100
+// where Window puts the connection list and the detail line on this screen
+#define TEST_LIST_FIRST 8
+#define TEST_LIST_ROWS 8
+#define TEST_DETAIL 18
+
+static bool rowStarts( HeadlessRenderer &renderer, int row, const std::string &text )
+{
+    // past the border, a box drawing character of three bytes
+    return renderer.getText( row ).compare( 4, text.length(), text ) == 0;
+}
+
+static std::string hostName( unsigned int i )
+{
+    std::ostringstream name;
+    name << "host" << ( i < 10 ? "0" : "" ) << i;
+    return name.str();
+}
+
+static bool listShows( HeadlessRenderer &renderer, unsigned int first )
+{
+    for ( unsigned int i = 0; i < TEST_LIST_ROWS; i++ ) {
+        if ( rowStarts( renderer, TEST_LIST_FIRST + i, hostName( first + i ) + " " ) == false ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    TestHome home;
+    if ( home.isValid() == false ) {
+        return 1;
+    }
+    std::string records;
+    for ( unsigned int i = 0; i < TEST_CONNECTIONS; i++ ) {
+        records += TestHome::record( hostName( i ), hostName( i ) + ".example", "g", "u" );
+    }
+    home.writeFile( ".scc/connections", records );
+    Resources::Instance()->getSSHDatabase()->waitForLoad();
+
+    int failures = 0;
+    HeadlessRenderer *renderer = new HeadlessRenderer( TEST_ROWS, TEST_COLUMNS );
+    {
+        Window window( renderer );
+        window.init();
+        window.drawFrame();
+        unsigned long long first = renderer->getBytes();
+        failures += expect( rowStarts( *renderer, 2, "Search:" ) == true && rowStarts( *renderer, 5, "* (100) > g (100)" ) == true,
+                            "the search box and the group bar" );
+        failures += expect( listShows( *renderer, 0 ) == true && rowStarts( *renderer, TEST_DETAIL, "host00 " ) == true,
+                            "the first rows of the list, the selected one in the detail line" );
+        failures += expect( first >= renderer->getChangedCells() && renderer->getScrolledRows() == 0,
+                            "the first frame draws the whole layout, %llu bytes for %llu cells", first, renderer->getChangedCells() );
+
+        window.drawFrame();
+        failures += expect( renderer->getBytes() == first, "an unchanged frame sends nothing" );
+
+        // down to the last visible row, the list stays where it is
+        for ( unsigned int i = 1; i < TEST_LIST_ROWS; i++ ) {
+            renderer->pushInput( K_DOWN, false );
+            window.drawFrame();
+        }
+        window.drawFrame();
+        failures += expect( listShows( *renderer, 0 ) == true && rowStarts( *renderer, TEST_DETAIL, "host07 " ) == true
+                            && renderer->getScrolledRows() == 0,
+                            "moving the selection within the list does not scroll" );
+
+        // one more and everything moves up a row
+        unsigned long long bytes = renderer->getBytes();
+        unsigned long long cells = renderer->getChangedCells();
+        renderer->pushInput( K_DOWN, false );
+        window.drawFrame();
+        window.drawFrame();
+        bytes = renderer->getBytes() - bytes;
+        cells = renderer->getChangedCells() - cells;
+        failures += expect( listShows( *renderer, 1 ) == true && rowStarts( *renderer, TEST_DETAIL, "host08 " ) == true,
+                            "the step down shows the next row at the bottom" );
+        failures += expect( renderer->getScrolledRows() == 1, "the rows are scrolled, %llu scrolled", renderer->getScrolledRows() );
+        // the new bottom row, the row that lost the selection and the detail line
+        failures += expect( cells <= 3 * TEST_COLUMNS && bytes < first / 4,
+                            "a scroll step repaints the changed rows only, %llu bytes for %llu cells", bytes, cells );
+    }
+    Resources::Instance()->DestroyInstance();
+    return failures > 0 ? 1 : 0;
+}